@@ -36,6 +36,44 @@
 #include "DS1820.h"
 #include "OneWire.h"
 
+#ifdef DS1820_TRACE_ENABLE
+#include "DS1820_Trace.h"
+
+/* Transaction phase hooks, phase end is recorded with the handle of its 
+ * begin. Selection remembers the selected device, Skip ROM on single device
+ * bus selects that device. */
+#define TRACE_SELECT(iAddress)      iTraceHandle = ((iAddress) != DS1820_ADDRESS_ALL) ? DS1820_DeviceHandle(iAddress) : \
+                                        (Bus.iFlags & BUS_SINGLE) ? Bus.iSingle : -1
+#define TRACE_BEGIN(iPhase, iHandle)            DS1820_TraceRecord(iPhase, iHandle, 0)
+#define TRACE_END(iPhase, iHandle, iResult)     DS1820_TraceRecord((iPhase) | DS1820_TRACE_END, iHandle, (uint8_t) (iResult))
+#else
+#define TRACE_SELECT(iAddress)
+#define TRACE_BEGIN(iPhase, iHandle)
+#define TRACE_END(iPhase, iHandle, iResult)
+#endif
+
+#ifdef DS1820_METRICS_ENABLE
+#include "DS1820_Metrics.h"
+
+/* Bus time accounting and public API measurement hooks */
+#define METRIC_BUS(iActivity, iTime)    DS1820_MetricsBusAdd(iActivity, iTime)
+#define API_BEGIN(iApi)                 DS1820_MetricsApiBegin(iApi)
+#define API_RETURN(iResult)             return DS1820_MetricsApiEnd(iResult)
+#else
+#define METRIC_BUS(iActivity, iTime)
+#define API_BEGIN(iApi)
+#define API_RETURN(iResult)             return (iResult)
+#endif
+
+#ifdef DS1820_CAPTURE_ENABLE
+#include "DS1820_Capture.h"
+
+/* Bus operation capture hook */
+#define CAPTURE(iOp, iByte, iAddress)   DS1820_CaptureRecord(iOp, iByte, iAddress)
+#else
+#define CAPTURE(iOp, iByte, iAddress)
+#endif
+
 /* DS1820 specific commands */
 #define SCRATCHPAD_READ     0xBE
 #define SCRATCHPAD_STORE    0x48
@@ -43,10 +81,104 @@
 #define SCRATCHPAD_RECALL   0xB8
 #define POWER_SUPPLY_READ   0xB4
 
+/* Overdrive ROM commands */
+#define OVERDRIVE_MATCH_ROM 0x69
+
 /* DS1820 scratchpad length in bytes */
 #define SCRATCHPAD_LENGTH   9
 #define SCRATCHPAD_CRC_POS  (SCRATCHPAD_LENGTH - 1)
 
+/* Scratchpad threshold positions */
+#define SCRATCHPAD_TH_POS   2
+#define SCRATCHPAD_TL_POS   3
+
+/* EEPROM copy duration in miliseconds */
+#define EEPROM_WRITE_TIME   10
+
+/* Maximum number of read slots spent waiting for EEPROM recall */
+#define RECALL_POLL_LIMIT   16
+
+#if (DS1820_INDEX_SIZE & (DS1820_INDEX_SIZE - 1)) || (DS1820_INDEX_SIZE < 2 * DS1820_MAX_DEVICES)
+#error "DS1820_INDEX_SIZE has to be power of two at least twice DS1820_MAX_DEVICES"
+#endif
+
+#define INDEX_MASK          (DS1820_INDEX_SIZE - 1)
+
+/* Device table flags */
+#define DEVICE_POWER_KNOWN  0x01
+#define DEVICE_PARASITE     0x02
+#define DEVICE_OVERDRIVE    0x04
+#define DEVICE_CONVERTED    0x08
+#define DEVICE_OVERDRIVE_LOST   0x10
+
+/* Bus state flags */
+#define BUS_POWER_MAPPED    0x01
+#define BUS_PARASITE        0x02
+#define BUS_SINGLE          0x04
+
+/* Power-on reset scratchpad signature (+85 C) */
+#define POR_TEMP_LSB        0xAA
+#define POR_TEMP_MSB        0x00
+#define POR_COUNT_REMAIN    0x0C
+#define POR_COUNT_PER_C     0x10
+
+/* Scratchpad count registers positions */
+#define SCRATCHPAD_REMAIN_POS   6
+#define SCRATCHPAD_PER_C_POS    7
+
+/* Device table entry */
+typedef struct _DS1820_Device {
+    uint64_t iAddress;
+    uint8_t iFlags;
+    uint8_t iFailures;
+    uint8_t iSkip;
+    uint8_t iStandardReads;
+    int16_t iLastTemp;
+    DS1820_Health Health;
+} DS1820_Device;
+
+/* Bus state with table of discovered devices, handle is the table position */
+typedef struct _DS1820_Bus {
+    DS1820_Device Devices[DS1820_MAX_DEVICES];
+    uint16_t Index[DS1820_INDEX_SIZE];
+    int iDeviceCount;
+    int iSingle;
+    uint8_t iFlags;
+    DS1820_State iFault;
+    int iAbsent;
+} DS1820_Bus;
+
+static DS1820_Bus Bus;
+
+/* Platform delay function, optional */
+static void (*DelayFunc)(int iMiliSeconds) = 0;
+
+/* Platform miliseconds tick function, optional */
+static uint32_t (*TickFunc)(void) = 0;
+
+/* Read engine sample consumers */
+static DS1820_SampleSink Sinks[DS1820_MAX_SINKS];
+static int iSinkCount = 0;
+
+/* Read engine retry policy */
+static DS1820_RetryPolicy RetryPolicy = {
+    DS1820_RETRY_NO_PRESENCE, DS1820_RETRY_CRC, DS1820_RETRY_NO_DEVICE,
+    DS1820_RETRY_BUDGET, DS1820_RETRY_BACKOFF, DS1820_RETRY_RECONVERT
+};
+
+#ifdef DS1820_METRICS_ENABLE
+/* Modeled timing of the current bus speed and strong pull-up state */
+static uint32_t iResetTime = DS1820_METRICS_RESET_TIME;
+static uint32_t iSlotTime = DS1820_METRICS_SLOT_TIME;
+static uint32_t iPullUpStart;
+static uint8_t bPullUp = 0;
+#endif
+
+#ifdef DS1820_TRACE_ENABLE
+/* Handle of the last selected device, recorded with phases inside selection */
+static int iTraceHandle = -1;
+#endif
+
 /* Internal functions */
 static uint8_t ScratchPadRead(uint8_t *bBuffer);
 static void ScratchPadWrite(uint8_t iThresholdHigh, uint8_t iThresholdLow);
@@ -54,69 +186,148 @@ static void ScratchPadStore(void);
 static void  ScratchPadRecall(void);
 static uint8_t PowerSupplyType(void);
 static void TemperatureConvert(void);
+static uint8_t ThresholdEncode(int iThreshold);
+static DS1820_Device *DeviceFind(uint64_t iAddress);
+static uint8_t StrongPullUpRequired(uint64_t iAddress, DS1820_Device *Device);
+static uint8_t BusReset(void);
+static uint8_t BusMatch(uint64_t iAddress);
+static void BusWrite(uint8_t iByte);
+static uint8_t BusRead(void);
+static void BusWeakPullUp(void);
+static void BusStrongPullUp(void);
+static uint64_t BusSearchFirst(uint8_t iFamily);
+static uint64_t BusSearchNext(void);
+static uint8_t DeviceSelect(uint64_t iAddress);
+static DS1820_State ScratchPadFill(const uint8_t *Buffer);
+static DS1820_State DeviceScratchPadRead(uint64_t iAddress, DS1820_Device *Device, uint8_t *Buffer);
+static DS1820_State DeviceConvert(uint64_t iAddress, DS1820_Device *Device);
+static DS1820_State DeviceTemperatureRead(uint64_t iAddress, DS1820_Device *Device, int *iTemp);
+static uint8_t PowerOnSignature(const uint8_t *Buffer, DS1820_Device *Device, int iTemp);
+static int DeviceTemperatureGet(uint64_t iAddress, DS1820_Device *Device);
+static int ReadPass(const int *Handles, int iCount);
+static void Reconvert(const int *Deferred, uint8_t *Left, int iDeferred);
+static DS1820_State DeviceRead(int iHandle);
+static uint8_t RetryCount(DS1820_State iState);
+static void DeviceBackoff(DS1820_Device *Device);
+static void HealthClear(DS1820_Device *Device);
+static void LatencyRecord(DS1820_Device *Device, uint32_t iLatency);
+#ifdef OW_SPEED_OVERDRIVE
+static uint8_t OverdriveSelect(uint64_t iAddress);
+static void OverdriveProbe(void);
+static void BusSpeedSet(uint8_t iSpeed);
+#endif
 
 /**
  * Initalizes and resets OneWire communication.
  */
 void DS1820_Init(void) {
     OW_Init();
-    OW_Reset();
+    BusReset();
+}
+
+/**
+ * Registers platform delay function. It is required only by functions which
+ * have to wait for the bus between two transactions, e.g. 
+ * DS1820_ConfigurationStoreDirty storing more than one device.
+ * @param Delay Pointer to blocking delay function in miliseconds.
+ */
+void DS1820_DelaySet(void (*Delay)(int iMiliSeconds)) {
+    DelayFunc = Delay;
+}
+
+/**
+ * Registers platform tick function used to timestamp samples.
+ * @param Tick Pointer to function returning free running miliseconds counter.
+ */
+void DS1820_TickSet(uint32_t (*Tick)(void)) {
+    TickFunc = Tick;
+}
+
+/**
+ * Returns current platform time.
+ * @return Miliseconds tick or 0 if no tick function is registered.
+ */
+uint32_t DS1820_TickGet(void) {
+    return (TickFunc) ? TickFunc() : 0;
 }
 
 /**
  * Initializes temperature measurement on DS1820 chip.
- * @warning This function sets communication pin in StrongPullUp state.
+ * @warning This function sets communication pin in StrongPullUp state unless
+ * all selected devices are known to be externally powered.
  * @warning The bus has to be in StrongPullUp state at least for 500 ms.
  * @param iAddress 64bit device address, use DS1820_ADDRESS_ALL for all 
  * devices.
  * @return DS1820_OK if successfull, DS1820_ERROR if failed.
  */
 DS1820_State DS1820_TemperatureConvert(uint64_t iAddress) {
+    API_BEGIN(DS1820_API_CONVERT);
 
-    /* Ready bus for communcation */
-    OW_WeakPullUp();
-
-    /* Device selection */
-    if (OW_ROMMatch(iAddress) == OW_NO_DEV) return DS1820_ERROR;
+    API_RETURN(DeviceConvert(iAddress, DeviceFind(iAddress)));
+}
 
-    /* Issue convert temperature command */
-    TemperatureConvert();
+/**
+ * Initializes temperature measurement on DS1820 chip from the device table.
+ * @warning This function sets communication pin in StrongPullUp state unless
+ * the device is known to be externally powered.
+ * @warning The bus has to be in StrongPullUp state at least for 500 ms.
+ * @param iHandle Device handle, see DS1820_DeviceHandle.
+ * @return DS1820_OK if successfull, DS1820_ERROR if failed.
+ */
+DS1820_State DS1820_TemperatureConvertHandle(int iHandle) {
+    API_BEGIN(DS1820_API_CONVERT);
 
-    /* Power up device */
-    OW_StrongPullUp();
+    if ((iHandle < 0) || (iHandle >= Bus.iDeviceCount)) API_RETURN(DS1820_ERROR);
 
-    return DS1820_OK;
+    API_RETURN(DeviceConvert(Bus.Devices[iHandle].iAddress, &Bus.Devices[iHandle]));
 }
 
 /**
  * Reads tepmerature from specific device. You have to use TemperatureConvert 
- * function before calling TemperatureGet.
+ * function before calling TemperatureGet. Skip ROM is used automatically if
+ * the device is the only one found by DS1820_Search.
  * @param iAddress 64bit device address, use DS1820_ADDRESS_ALL to skip 
  * address match (only for single device on the bus).
  * @return Temperature in degrees of Celsius * 10 or DS1820_TEMP_ERROR in case 
- * of an error.
+ * of an error or power-on value.
  */
 int DS1820_TemperatureGet(uint64_t iAddress) {
-    int32_t iTemp;
-    uint8_t iSPad[SCRATCHPAD_LENGTH];
+    API_BEGIN(DS1820_API_GET);
 
-    /* Ready bus for communcation */
-    OW_WeakPullUp();
+    API_RETURN(DeviceTemperatureGet(iAddress, DeviceFind(iAddress)));
+}
 
-    /* Select device, fail if not present */
-    if (OW_ROMMatch(iAddress)) return DS1820_TEMP_ERROR;
+/**
+ * Reads tepmerature from device in the device table. You have to use 
+ * TemperatureConvert function before calling TemperatureGetHandle.
+ * @param iHandle Device handle, see DS1820_DeviceHandle.
+ * @return Temperature in degrees of Celsius * 10 or DS1820_TEMP_ERROR in case 
+ * of an error.
+ */
+int DS1820_TemperatureGetHandle(int iHandle) {
+    API_BEGIN(DS1820_API_GET);
 
-    /* Read DS1820 scratchpad, fail if CRC do not match */
-    if (ScratchPadRead(iSPad)) return DS1820_TEMP_ERROR;
+    if ((iHandle < 0) || (iHandle >= Bus.iDeviceCount)) API_RETURN(DS1820_TEMP_ERROR);
 
-    /* Calculate temperature from Scratchpad, step 1 */
-    iTemp = (iSPad[1] == 0) ? ((int) iSPad[0] * 500) : ((int) iSPad[0] * -500);
+    API_RETURN(DeviceTemperatureGet(Bus.Devices[iHandle].iAddress, &Bus.Devices[iHandle]));
+}
 
-    /* Calculate temperature from scratchpad, step 2 (High resolution) */
-    iTemp += -250 + ((1000 * (iSPad[7] - iSPad[6])) / iSPad[7]);
+/**
+ * Reads tepmerature from specific device and reports the cause of failure. 
+ * You have to use TemperatureConvert function before calling TemperatureRead.
+ * @param iAddress 64bit device address, use DS1820_ADDRESS_ALL to skip 
+ * address match (only for single device on the bus).
+ * @param iTemp Output for temperature in degrees of Celsius * 10.
+ * @return DS1820_OK if successfull, DS1820_NO_PRESENCE if no device answered
+ * reset, DS1820_CRC_ERROR if CRC do not match, DS1820_BUS_SHORT if the bus is
+ * stuck low, DS1820_NO_DEVICE if device vanished after presence (all ones),
+ * DS1820_POWER_ON_RESET if device holds its power-on value (+85 C), 
+ * DS1820_STALE if device was not addressed by convert since its last reading.
+ */
+DS1820_State DS1820_TemperatureRead(uint64_t iAddress, int *iTemp) {
+    API_BEGIN(DS1820_API_GET);
 
-    /* Return final value and cut unnecessary decimal places */
-    return (int) (iTemp / 100);
+    API_RETURN(DeviceTemperatureRead(iAddress, DeviceFind(iAddress), iTemp));
 }
 
 /**
@@ -128,21 +339,93 @@ int DS1820_TemperatureGet(uint64_t iAddress) {
  * @return DS1820_OK if successfull, DS1820_ERROR if failed.
  */
 DS1820_State DS1820_TemperatureAlarmSet(uint64_t iAddress, int iHigh, int iLow) {
-    uint8_t iConvHigh, iConvLow;
+    API_BEGIN(DS1820_API_ALARM_SET);
 
     /* Ready bus for communcation */
-    OW_WeakPullUp();
+    BusWeakPullUp();
 
     /* Select device, fail if not present */
-    if (OW_ROMMatch(iAddress)) return DS1820_ERROR;
+    if (BusMatch(iAddress)) API_RETURN(DS1820_ERROR);
+
+    ScratchPadWrite(ThresholdEncode(iHigh), ThresholdEncode(iLow));
+
+    API_RETURN(DS1820_OK);
+}
+
+/**
+ * Function sets temperature alarms of many devices at once. The most common 
+ * threshold pair is broadcasted by a single Skip ROM transaction, devices with
+ * different thresholds are then written separately.
+ * @warning Thresholds are broadcasted, Addresses should contain all devices on
+ * the bus (see DS1820_Search).
+ * @param Addresses Array of 64bit device addresses.
+ * @param iHigh Array of high temperature thresholds, in degrees of Celsius.
+ * @param iLow Array of low temperature thresholds, in degrees of Celsius.
+ * @param iCount Number of devices in arrays.
+ * @param bVerify Read back thresholds of all devices if nonzero.
+ * @return DS1820_OK if successfull, DS1820_ERROR if failed or verification 
+ * did not match.
+ */
+DS1820_State DS1820_TemperatureAlarmSetMany(uint64_t *Addresses, int *iHigh, int *iLow, int iCount, int bVerify) {
+    int i, j, iVotes, iBest = 0;
+    uint8_t iSPad[SCRATCHPAD_LENGTH];
+    uint8_t iConvHigh, iConvLow, iCommonHigh = 0, iCommonLow = 0;
 
-    iConvHigh = (iHigh >= 0) ? (uint8_t) iHigh & 0x7F : 0x80 | ((uint8_t) iHigh & 0x7F);
+    API_BEGIN(DS1820_API_ALARM_SET);
 
-    iConvLow = (iLow >= 0) ? (uint8_t) iLow & 0x7F : 0x80 | ((uint8_t) iLow & 0x7F);
+    if (iCount <= 0) API_RETURN(DS1820_ERROR);
 
-    ScratchPadWrite(iConvHigh, iConvLow);
+    /* Find the most common threshold pair, the first one wins a tie */
+    for (i = 0; i < iCount; i++) {
+        iConvHigh = ThresholdEncode(iHigh[i]);
+        iConvLow = ThresholdEncode(iLow[i]);
 
-    return DS1820_OK;
+        /* Pair already counted at its first occurence */
+        for (j = 0; j < i; j++)
+            if ((ThresholdEncode(iHigh[j]) == iConvHigh) && (ThresholdEncode(iLow[j]) == iConvLow)) break;
+        if (j < i) continue;
+
+        for (iVotes = 0; j < iCount; j++)
+            if ((ThresholdEncode(iHigh[j]) == iConvHigh) && (ThresholdEncode(iLow[j]) == iConvLow)) iVotes++;
+
+        if (iVotes > iBest) {
+            iBest = iVotes;
+            iCommonHigh = iConvHigh;
+            iCommonLow = iConvLow;
+        }
+    }
+
+    /* Ready bus for communcation */
+    BusWeakPullUp();
+
+    /* Broadcast common thresholds */
+    if (BusMatch(DS1820_ADDRESS_ALL)) API_RETURN(DS1820_ERROR);
+    ScratchPadWrite(iCommonHigh, iCommonLow);
+
+    /* Write thresholds which differ */
+    for (i = 0; i < iCount; i++) {
+        iConvHigh = ThresholdEncode(iHigh[i]);
+        iConvLow = ThresholdEncode(iLow[i]);
+
+        if ((iConvHigh == iCommonHigh) && (iConvLow == iCommonLow)) continue;
+
+        if (BusMatch(Addresses[i])) API_RETURN(DS1820_ERROR);
+        ScratchPadWrite(iConvHigh, iConvLow);
+    }
+
+    if (!bVerify) API_RETURN(DS1820_OK);
+
+    /* Read back all devices, fail if CRC or thresholds do not match */
+    for (i = 0; i < iCount; i++) {
+        if (BusMatch(Addresses[i])) API_RETURN(DS1820_ERROR);
+        if (ScratchPadRead(iSPad)) API_RETURN(DS1820_ERROR);
+
+        if ((iSPad[SCRATCHPAD_TH_POS] != ThresholdEncode(iHigh[i])) ||
+                (iSPad[SCRATCHPAD_TL_POS] != ThresholdEncode(iLow[i])))
+            API_RETURN(DS1820_ERROR);
+    }
+
+    API_RETURN(DS1820_OK);
 }
 
 /**
@@ -156,46 +439,46 @@ DS1820_State DS1820_TemperatureAlarmSet(uint64_t iAddress, int iHigh, int iLow)
 DS1820_State DS1820_TemperatureAlarmGet(uint64_t iAddress, int *iHigh, int *iLow) {
     uint8_t iSPad[SCRATCHPAD_LENGTH];
 
-    /* Ready bus for communcation */
-    OW_WeakPullUp();
-
-    /* Select device, fail if not present */
-    if (OW_ROMMatch(iAddress)) return DS1820_ERROR;
+    API_BEGIN(DS1820_API_ALARM_GET);
 
-    /* Read DS1820 scratchpad, fail if CRC do not match */
-    if (ScratchPadRead(iSPad)) return DS1820_ERROR;
+    /* Ready bus for communcation */
+    BusWeakPullUp();
 
-    /* Calculate high temperature threshold from scratchpad */
-    (*iHigh) = (iSPad[3] & 0x80) ? -((int) (iSPad[3] & 0x7F)) : (int) (iSPad[3] & 0x7F);
+    /* Select device and read DS1820 scratchpad, fail if CRC do not match */
+    if (DeviceScratchPadRead(iAddress, DeviceFind(iAddress), iSPad)) API_RETURN(DS1820_ERROR);
 
-    /* Calculate low temperature threshold from scratchpad */
-    (*iLow) = (iSPad[4] & 0x80) ? -((int) (iSPad[4] & 0x7F)) : (int) (iSPad[4] & 0x7F);
+    /* Thresholds are stored in two's complement, see ThresholdEncode */
+    (*iHigh) = (int) (int8_t) iSPad[SCRATCHPAD_TH_POS];
+    (*iLow) = (int) (int8_t) iSPad[SCRATCHPAD_TL_POS];
 
-    return DS1820_OK;
+    API_RETURN(DS1820_OK);
 }
 
 /**
  * Saves device volatile configuration into internal EEPROM.
- * @warning This function sets communication pin in StrongPullUp state.
+ * @warning This function sets communication pin in StrongPullUp state unless
+ * all selected devices are known to be externally powered.
  * @warning The bus has to be in StrongPullUp state at least for 10 ms.
  * @param iAddress 64bit device address, use DS1820_ADDRESS_ALL for all 
  * devices.
  * @return DS1820_OK if successfull, DS1820_ERROR if failed.
  */
 DS1820_State DS1820_ConfigurationStore(uint64_t iAddress) {
+    API_BEGIN(DS1820_API_STORE);
+
     /* Ready bus for communcation */
-    OW_WeakPullUp();
+    BusWeakPullUp();
 
     /* Select device, fail if not present */
-    if (OW_ROMMatch(iAddress)) return DS1820_ERROR;
+    if (BusMatch(iAddress)) API_RETURN(DS1820_ERROR);
 
     /* Store configuration */
     ScratchPadStore();
 
     /* Power up device */
-    OW_StrongPullUp();
+    if (StrongPullUpRequired(iAddress, DeviceFind(iAddress))) BusStrongPullUp();
 
-    return DS1820_OK;
+    API_RETURN(DS1820_OK);
 }
 
 /**
@@ -205,124 +488,1276 @@ DS1820_State DS1820_ConfigurationStore(uint64_t iAddress) {
  * @return DS1820_OK if successfull, DS1820_ERROR if failed.
  */
 DS1820_State DS1820_ConfigurationRecall(uint64_t iAddress) {
+    API_BEGIN(DS1820_API_RECALL);
+
     /* Ready bus for communcation */
-    OW_WeakPullUp();
+    BusWeakPullUp();
 
     /* Select device, fail if not present */
-    if (OW_ROMMatch(iAddress)) return DS1820_ERROR;
+    if (BusMatch(iAddress)) API_RETURN(DS1820_ERROR);
     
     /* Recall configuration */
     ScratchPadRecall();
     
-    return DS1820_OK;
+    API_RETURN(DS1820_OK);
 }
 
 /**
- * 
+ * Saves volatile configuration into EEPROM only for devices where it differs
+ * from the EEPROM contents. Pending thresholds are read first, then EEPROM is
+ * recalled into all scratchpads by a single Skip ROM transaction and compared.
+ * Changed thresholds are written back and stored, by a single Skip ROM store 
+ * if all devices are dirty or device by device otherwise.
+ * @warning This function sets communication pin in StrongPullUp state if at
+ * least one device has been stored, unless it is known to be externally
+ * powered.
+ * @warning The bus has to be in StrongPullUp state at least for 10 ms.
+ * @warning Recall and store are broadcasted, Addresses should contain all 
+ * devices on the bus (see DS1820_Search).
+ * @warning Storing more than one device separately requires delay function,
+ * see DS1820_DelaySet.
+ * @param Addresses Array of 64bit device addresses.
+ * @param iCount Number of devices in array, at most DS1820_MAX_DEVICES.
+ * @param iStored Number of stored devices output, can be NULL.
+ * @return DS1820_OK if successfull, DS1820_ERROR if failed.
+ */
+DS1820_State DS1820_ConfigurationStoreDirty(uint64_t *Addresses, int iCount, int *iStored) {
+    int i, iDirty = 0, iDone = 0;
+    uint8_t iSPad[SCRATCHPAD_LENGTH];
+    uint8_t Pending[DS1820_MAX_DEVICES][2];
+    uint8_t Dirty[DS1820_MAX_DEVICES];
+
+    API_BEGIN(DS1820_API_STORE);
+
+    if (iStored) (*iStored) = 0;
+
+    if ((iCount <= 0) || (iCount > DS1820_MAX_DEVICES)) API_RETURN(DS1820_ERROR);
+
+    /* Ready bus for communcation */
+    BusWeakPullUp();
+
+    /* Remember volatile TH and TL of every device */
+    for (i = 0; i < iCount; i++) {
+        if (BusMatch(Addresses[i])) API_RETURN(DS1820_ERROR);
+        if (ScratchPadRead(iSPad)) API_RETURN(DS1820_ERROR);
+        Pending[i][0] = iSPad[SCRATCHPAD_TH_POS];
+        Pending[i][1] = iSPad[SCRATCHPAD_TL_POS];
+    }
+
+    /* Load EEPROM contents into all scratchpads at once */
+    if (BusMatch(DS1820_ADDRESS_ALL)) API_RETURN(DS1820_ERROR);
+    ScratchPadRecall();
+
+    /* Wait for recall to complete, devices send ones when done */
+    for (i = 0; i < RECALL_POLL_LIMIT; i++)
+        if (BusRead() == 0xFF) break;
+
+    /* Compare EEPROM with pending thresholds and restore them */
+    for (i = 0; i < iCount; i++) {
+        if (BusMatch(Addresses[i])) API_RETURN(DS1820_ERROR);
+
+        /* Unreadable device is considered dirty */
+        Dirty[i] = ScratchPadRead(iSPad) ||
+                (iSPad[SCRATCHPAD_TH_POS] != Pending[i][0]) ||
+                (iSPad[SCRATCHPAD_TL_POS] != Pending[i][1]);
+
+        if (!Dirty[i]) continue;
+
+        if (BusMatch(Addresses[i])) API_RETURN(DS1820_ERROR);
+        ScratchPadWrite(Pending[i][0], Pending[i][1]);
+        iDirty++;
+    }
+
+    /* EEPROM already matches */
+    if (iDirty == 0) API_RETURN(DS1820_OK);
+
+    /* Store all devices by single transaction */
+    if (iDirty == iCount) {
+        if (BusMatch(DS1820_ADDRESS_ALL)) API_RETURN(DS1820_ERROR);
+        ScratchPadStore();
+        if (StrongPullUpRequired(DS1820_ADDRESS_ALL, 0)) BusStrongPullUp();
+        if (iStored) (*iStored) = iCount;
+        API_RETURN(DS1820_OK);
+    }
+
+    /* Unable to wait between stores */
+    if ((iDirty > 1) && (DelayFunc == 0)) API_RETURN(DS1820_ERROR);
+
+    /* Store dirty devices one by one */
+    for (i = 0; i < iCount; i++) {
+        if (!Dirty[i]) continue;
+
+        /* Wait for previous EEPROM write to complete */
+        if (iDone) {
+            DelayFunc(EEPROM_WRITE_TIME);
+            BusWeakPullUp();
+        }
+
+        if (BusMatch(Addresses[i])) API_RETURN(DS1820_ERROR);
+        ScratchPadStore();
+        if (StrongPullUpRequired(Addresses[i], DeviceFind(Addresses[i]))) BusStrongPullUp();
+
+        iDone++;
+        if (iStored) (*iStored) = iDone;
+    }
+
+    API_RETURN(DS1820_OK);
+}
+
+/**
+ * Reads device power supply type. Answer is taken from the power map when
+ * known (see DS1820_PowerMapBuild), otherwise the device is asked and the 
+ * answer is cached.
  * @param iAddress 64bit device address, use DS1820_ADDRESS_ALL for all 
  * devices.
  * @return DS1820_PARASITE_POWER (if at least one device is parasite powered) or
  * DS1820_EXTERNAL_POWER if successfull, DS1820_ERROR if failed.
  */
-DS1820_State DS1820_PowerTypeGet(uint64_t iAddress){
-     /* Ready bus for communcation */
-    OW_WeakPullUp();
+DS1820_State DS1820_PowerTypeGet(uint64_t iAddress) {
+    DS1820_Device *Device;
+    uint8_t iType;
+
+    API_BEGIN(DS1820_API_POWER);
+
+    /* Use cached power type */
+    if (iAddress == DS1820_ADDRESS_ALL) {
+        if (Bus.iFlags & BUS_POWER_MAPPED)
+            API_RETURN((Bus.iFlags & BUS_PARASITE) ? DS1820_PARASITE_POWER : DS1820_EXTERNAL_POWER);
+        Device = 0;
+    } else {
+        Device = DeviceFind(iAddress);
+        if ((Device) && (Device->iFlags & DEVICE_POWER_KNOWN))
+            API_RETURN((Device->iFlags & DEVICE_PARASITE) ? DS1820_PARASITE_POWER : DS1820_EXTERNAL_POWER);
+    }
+
+    /* Ready bus for communcation */
+    BusWeakPullUp();
 
     /* Select device, fail if not present */
-    if (OW_ROMMatch(iAddress)) return DS1820_ERROR;
-    
-    return PowerSupplyType();
+    if (DeviceSelect(iAddress)) API_RETURN(DS1820_ERROR);
+
+    iType = PowerSupplyType();
+
+    /* Cache device power type */
+    if (Device) {
+        Device->iFlags |= DEVICE_POWER_KNOWN;
+        if (iType == DS1820_PARASITE_POWER) Device->iFlags |= DEVICE_PARASITE;
+    }
+
+    API_RETURN(iType);
+}
+
+/**
+ * Builds power map of all devices found by DS1820_Search. One Skip ROM power
+ * supply read tells if any device is parasite powered, devices are asked one
+ * by one only in that case. Convert and store functions do not use 
+ * StrongPullUp state on fully externally powered bus.
+ * @return DS1820_OK if successfull, DS1820_ERROR if failed.
+ */
+DS1820_State DS1820_PowerMapBuild(void) {
+    int i;
+    DS1820_Device *Device;
+
+    API_BEGIN(DS1820_API_POWER);
+
+    Bus.iFlags &= ~(BUS_POWER_MAPPED | BUS_PARASITE);
+
+    /* Ready bus for communcation */
+    BusWeakPullUp();
+
+    /* Ask all devices at once */
+    if (BusMatch(DS1820_ADDRESS_ALL)) API_RETURN(DS1820_ERROR);
+
+    if (PowerSupplyType() == DS1820_EXTERNAL_POWER) {
+        for (i = 0; i < Bus.iDeviceCount; i++)
+            Bus.Devices[i].iFlags = (Bus.Devices[i].iFlags & ~DEVICE_PARASITE) | DEVICE_POWER_KNOWN;
+
+        Bus.iFlags |= BUS_POWER_MAPPED;
+        API_RETURN(DS1820_OK);
+    }
+
+    /* At least one device is parasite powered, ask each device */
+    Bus.iFlags |= BUS_PARASITE;
+
+    for (i = 0; i < Bus.iDeviceCount; i++) {
+        Device = &Bus.Devices[i];
+        Device->iFlags &= ~(DEVICE_POWER_KNOWN | DEVICE_PARASITE);
+
+        if (BusMatch(Device->iAddress)) API_RETURN(DS1820_ERROR);
+
+        Device->iFlags |= DEVICE_POWER_KNOWN;
+        if (PowerSupplyType() == DS1820_PARASITE_POWER) Device->iFlags |= DEVICE_PARASITE;
+    }
+
+    Bus.iFlags |= BUS_POWER_MAPPED;
+    API_RETURN(DS1820_OK);
 }
 
 /**
  * Function searches for DS1820 devices on the bus and stores them in to array.
+ * The internal device table is rebuilt from the found devices, devices which
+ * left the bus or were added by DS1820_DeviceAdd are removed and handles are
+ * given in search order, so they change only if the set of devices does. 
+ * Their power map is built and overdrive capability is probed if supported by
+ * the OneWire library.
  * @param Addresses Pointer to array for device addresses to be stored. 
  * @param iMaxDevices Maximum of devices to be searched.
  * @return Number of devices found.
  */
 int DS1820_Search(uint64_t *Addresses, int iMaxDevices) {
-    int iCount = 0;
+    int iCount = 0, iHandle = -1;
     uint64_t iAddress;
 
+    API_BEGIN(DS1820_API_SEARCH);
+
+    TRACE_BEGIN(DS1820_TRACE_SEARCH, -1);
+
     /* Ready bus for communcation */
-    OW_WeakPullUp();
+    BusWeakPullUp();
 
     /* Search for first DS1820 device */
-    iAddress = OW_SearchFirst(0);
+    iAddress = BusSearchFirst(0);
+
+    /* Device table holds only devices present now */
+    DS1820_DeviceClear();
 
-    /* Store all device addresses into a array */
+    /* Store all device addresses into a array and the device table */
     while ((iAddress) && (iCount < iMaxDevices)) {
         iCount++;
         Addresses[iCount - 1] = iAddress;
-        iAddress = OW_SearchNext();
+        iHandle = DS1820_DeviceAdd(iAddress);
+
+        iAddress = BusSearchNext();
     }
 
     /* Reset communication */
-    OW_Reset();
+    BusReset();
+
+    TRACE_END(DS1820_TRACE_SEARCH, -1, iCount == 0);
+
+    /* Only device on the bus can be selected by Skip ROM */
+    if ((iCount == 1) && (iAddress == 0) && (iHandle >= 0)) {
+        Bus.iFlags |= BUS_SINGLE;
+        Bus.iSingle = iHandle;
+    }
 
-    return iCount;
+#ifdef OW_SPEED_OVERDRIVE
+    /* Find devices capable of overdrive speed */
+    OverdriveProbe();
+#endif
+
+    /* Learn which devices need StrongPullUp */
+    if (iCount) DS1820_PowerMapBuild();
+
+    API_RETURN(iCount);
 }
 
 /**
- * This internal function reads a device scratchpad and calculates CRC.
- * @param Buffer Scratchpad output
- * @return 0 if CRC match, 1 if do not.
+ * Adds device into the device table. Handles are stable, device keeps its 
+ * handle until DS1820_DeviceClear or DS1820_Search is called.
+ * @param iAddress 64bit device address.
+ * @return Device handle or -1 if the device table is full.
  */
-uint8_t ScratchPadRead(uint8_t *Buffer) {
-    int i;
-    uint8_t iCRC = 0;
+int DS1820_DeviceAdd(uint64_t iAddress) {
+    uint32_t iSlot = DS1820_ADDRESS_HASH(iAddress) & INDEX_MASK;
+    DS1820_Device *Device;
 
-    /* Issue read scratchpad command */
-    OW_ByteWrite(SCRATCHPAD_READ);
+    if (iAddress == DS1820_ADDRESS_ALL) return -1;
 
-    /* Read scratchpad */
-    for (i = 0; i < SCRATCHPAD_LENGTH; i++) {
-        Buffer[i] = OW_ByteRead();
-        /* Calculate CRC */
-        if (i != SCRATCHPAD_CRC_POS)
-            iCRC = OW_CRCCalculate(iCRC, Buffer[i]);
+    /* Find device or first empty index slot */
+    while (Bus.Index[iSlot]) {
+        if (Bus.Devices[Bus.Index[iSlot] - 1].iAddress == iAddress) return Bus.Index[iSlot] - 1;
+        iSlot = (iSlot + 1) & INDEX_MASK;
     }
-    /* Match CRC */
-    return (iCRC != Buffer[SCRATCHPAD_CRC_POS]);
+
+    if (Bus.iDeviceCount >= DS1820_MAX_DEVICES) return -1;
+
+    Device = &Bus.Devices[Bus.iDeviceCount];
+    Device->iAddress = iAddress;
+    Device->iFlags = 0;
+    Device->iFailures = 0;
+    Device->iSkip = 0;
+    Device->iStandardReads = 0;
+    Device->iLastTemp = DS1820_TEMP_ERROR;
+    HealthClear(Device);
+
+    Bus.Index[iSlot] = (uint16_t) (++Bus.iDeviceCount);
+
+    return Bus.iDeviceCount - 1;
 }
 
 /**
- * This internal function write two bytes into a device scratchpad.
- * @param iThresholdHigh High temperature threshold, MSB is sign bit.
- * @param iThresholdLow Low temperature threshold, MSB is sign bit.
+ * Finds device handle by address.
+ * @param iAddress 64bit device address.
+ * @return Device handle or -1 if the device is not in the device table.
  */
-void ScratchPadWrite(uint8_t iThresholdHigh, uint8_t iThresholdLow) {
-    OW_ByteWrite(SCRATCHPAD_WRITE);
-    OW_ByteWrite(iThresholdHigh);
-    OW_ByteWrite(iThresholdLow);
+int DS1820_DeviceHandle(uint64_t iAddress) {
+    uint32_t iSlot = DS1820_ADDRESS_HASH(iAddress) & INDEX_MASK;
+
+    while (Bus.Index[iSlot]) {
+        if (Bus.Devices[Bus.Index[iSlot] - 1].iAddress == iAddress) return Bus.Index[iSlot] - 1;
+        iSlot = (iSlot + 1) & INDEX_MASK;
+    }
+
+    return -1;
 }
 
 /**
- * Store configuration into EEPROM.
+ * Removes all devices from the device table, handles become invalid.
  */
-void ScratchPadStore(void) {
-    OW_ByteWrite(SCRATCHPAD_STORE);
+void DS1820_DeviceClear(void) {
+    int i;
+
+    for (i = 0; i < DS1820_INDEX_SIZE; i++) Bus.Index[i] = 0;
+
+    Bus.iDeviceCount = 0;
+    Bus.iFlags = 0;
+    DS1820_BusFaultClear();
 }
 
 /**
- * Recall configuration from EEPROM.
+ * Returns number of devices in the device table, valid handles are 0 to 
+ * DS1820_DeviceCount() - 1.
+ * @return Number of devices in the device table.
  */
-void ScratchPadRecall(void) {
-    OW_ByteWrite(SCRATCHPAD_RECALL);
+int DS1820_DeviceCount(void) {
+    return Bus.iDeviceCount;
 }
 
 /**
- * Reads device power supply configuration.
- * @return DS1820_PARASITE_POWER or DS1820_EXTERNAL_POWER
+ * Returns address of device from the device table.
+ * @param iHandle Device handle.
+ * @return 64bit device address or DS1820_ADDRESS_ALL if handle is invalid.
  */
-uint8_t PowerSupplyType(void) {
-    OW_ByteWrite(POWER_SUPPLY_READ);
-    return (OW_ByteRead()) ? DS1820_EXTERNAL_POWER : DS1820_PARASITE_POWER;
+uint64_t DS1820_DeviceAddress(int iHandle) {
+    if ((iHandle < 0) || (iHandle >= Bus.iDeviceCount)) return DS1820_ADDRESS_ALL;
+
+    return Bus.Devices[iHandle].iAddress;
 }
 
 /**
- * Starts temperature conversion.
+ * Registers sample consumer of the read engine, e.g. DS1820_RingSink.
+ * @param Sink Consumer function.
+ * @return DS1820_OK if successfull, DS1820_ERROR if there are already 
+ * DS1820_MAX_SINKS consumers.
  */
-void TemperatureConvert(void) {
-    OW_ByteWrite(0x44);
+DS1820_State DS1820_SampleSinkAdd(DS1820_SampleSink Sink) {
+    if (iSinkCount >= DS1820_MAX_SINKS) return DS1820_ERROR;
+
+    Sinks[iSinkCount++] = Sink;
+
+    return DS1820_OK;
+}
+
+/**
+ * Read engine, reads temperature of all devices in the device table and passes
+ * valid readings with timestamp to registered consumers. You have to use 
+ * TemperatureConvert function before calling TemperatureReadAll.
+ * @return Number of valid readings.
+ */
+int DS1820_TemperatureReadAll(void) {
+    API_BEGIN(DS1820_API_READ);
+
+    API_RETURN(ReadPass(0, Bus.iDeviceCount));
+}
+
+/**
+ * Read engine, reads temperature of selected devices from the device table and
+ * passes valid readings with timestamp to registered consumers.
+ * @param Handles Array of device handles.
+ * @param iCount Number of handles.
+ * @return Number of valid readings.
+ */
+int DS1820_TemperatureReadList(const int *Handles, int iCount) {
+    API_BEGIN(DS1820_API_READ);
+
+    API_RETURN(ReadPass(Handles, iCount));
+}
+
+/**
+ * Read engine, reads temperature of one device from the device table right 
+ * now and passes valid reading with timestamp to registered consumers. Unlike
+ * DS1820_TemperatureReadList the device is read even if it is in backoff, 
+ * valid reading ends the backoff. Like a pass it clears latched bus fault 
+ * first. Failed reading is not retried, it is up to the caller (see 
+ * DS1820_SchedulerRun).
+ * @param iHandle Device handle.
+ * @return DS1820_OK if reading was valid, DS1820_ERROR if handle is invalid,
+ * failure as DS1820_TemperatureRead otherwise.
+ */
+DS1820_State DS1820_TemperatureReadHandle(int iHandle) {
+    DS1820_State iState;
+    DS1820_Device *Device;
+
+    API_BEGIN(DS1820_API_READ);
+
+    if ((iHandle < 0) || (iHandle >= Bus.iDeviceCount)) API_RETURN(DS1820_ERROR);
+    Device = &Bus.Devices[iHandle];
+
+    DS1820_BusFaultClear();
+
+    iState = DeviceRead(iHandle);
+    if (iState == DS1820_OK) {
+        Device->iFailures = 0;
+        Device->iSkip = 0;
+    }
+
+    API_RETURN(iState);
+}
+
+/**
+ * Sets read engine retry policy. Failed readings are retried at the end of 
+ * the pass, so they do not delay other devices, up to the per error class 
+ * count and the retry budget shared by all devices of one pass. Device which 
+ * fails in consecutive passes sits out 1, 3, 7, ... passes, up to 
+ * 2^iBackoffLimit - 1. Up to iReconvert devices holding power-on value or
+ * stale conversion are converted again, parasite powered ones one at a time,
+ * so the pass takes one conversion time per such device.
+ * @param Policy Retry counts for DS1820_NO_PRESENCE, DS1820_CRC_ERROR and 
+ * DS1820_NO_DEVICE failures, retry budget per pass, backoff limit (max 7) and
+ * number of devices converted again per pass.
+ */
+void DS1820_RetryPolicySet(const DS1820_RetryPolicy *Policy) {
+    RetryPolicy = *Policy;
+
+    if (RetryPolicy.iBackoffLimit > 7) RetryPolicy.iBackoffLimit = 7;
+}
+
+/**
+ * Returns bus fault latched by the read engine. Once a fault is latched the 
+ * engine skips the remaining reads of the pass. Every pass starts with the
+ * fault cleared, so the fault tells why the last pass stopped.
+ * @return DS1820_OK if no fault is latched, DS1820_BUS_SHORT if the bus is 
+ * stuck low, DS1820_NO_PRESENCE if DS1820_FAULT_ABSENT consecutive devices 
+ * did not answer and no device answered the following bus reset (open bus).
+ */
+DS1820_State DS1820_BusFault(void) {
+    return Bus.iFault;
+}
+
+/**
+ * Clears latched bus fault. It is not needed before the next pass, which 
+ * clears the fault itself.
+ */
+void DS1820_BusFaultClear(void) {
+    Bus.iFault = DS1820_OK;
+    Bus.iAbsent = 0;
+}
+
+/**
+ * Returns copy of device health counters. Counters are updated by all reads of
+ * devices in the device table, retries and latency only by the read engine.
+ * @param iHandle Device handle.
+ * @param Health Output for counters.
+ * @return DS1820_OK if successfull, DS1820_ERROR if handle is invalid.
+ */
+DS1820_State DS1820_HealthGet(int iHandle, DS1820_Health *Health) {
+    if ((iHandle < 0) || (iHandle >= Bus.iDeviceCount)) return DS1820_ERROR;
+
+    *Health = Bus.Devices[iHandle].Health;
+
+    return DS1820_OK;
+}
+
+/**
+ * Resets device health counters.
+ * @param iHandle Device handle or -1 for all devices in the device table.
+ */
+void DS1820_HealthReset(int iHandle) {
+    int i;
+
+    for (i = 0; i < Bus.iDeviceCount; i++)
+        if ((iHandle < 0) || (iHandle == i)) HealthClear(&Bus.Devices[i]);
+}
+
+/**
+ * Read engine pass, reads devices once, then retries failed ones according to
+ * the retry policy and backs off devices which failed again. Devices holding
+ * power-on value or stale conversion are converted again and read once more
+ * after conversion time, if delay function is registered.
+ * @param Handles Array of device handles or NULL for the whole device table.
+ * @param iCount Number of handles.
+ * @return Number of valid readings.
+ */
+int ReadPass(const int *Handles, int iCount) {
+    int i, iHandle, iValid = 0, iDeferred = 0, iBudget = RetryPolicy.iBudget;
+    int iReconvert = 0;
+    int Deferred[DS1820_MAX_DEVICES];
+    uint8_t Left[DS1820_MAX_DEVICES];
+    DS1820_State States[DS1820_MAX_DEVICES];
+    uint8_t bRetried = 1;
+    DS1820_State iState;
+    DS1820_Device *Device;
+
+    /* Fault of the previous pass may have been transient */
+    DS1820_BusFaultClear();
+
+    for (i = 0; (i < iCount) && (!Bus.iFault); i++) {
+        iHandle = (Handles) ? Handles[i] : i;
+        if ((iHandle < 0) || (iHandle >= Bus.iDeviceCount)) continue;
+        Device = &Bus.Devices[iHandle];
+
+        /* Device in backoff sits out this pass */
+        if (Device->iSkip) {
+            Device->iSkip--;
+            Device->Health.iSkipped++;
+            continue;
+        }
+
+        iState = DeviceRead(iHandle);
+        if (iState == DS1820_OK) {
+            Device->iFailures = 0;
+            iValid++;
+        } else if (iDeferred < DS1820_MAX_DEVICES) {
+            Deferred[iDeferred] = iHandle;
+            States[iDeferred] = iState;
+            Left[iDeferred++] = RetryCount(iState);
+        } else {
+            DeviceBackoff(Device);
+        }
+    }
+
+    /* Deferred retries, one per device and round while budget lasts */
+    while ((bRetried) && (iBudget > 0) && (!Bus.iFault)) {
+        bRetried = 0;
+
+        for (i = 0; (i < iDeferred) && (iBudget > 0) && (!Bus.iFault); i++) {
+            if (Left[i] == 0) continue;
+            iHandle = Deferred[i];
+            Device = &Bus.Devices[iHandle];
+
+            iBudget--;
+            Left[i]--;
+            bRetried = 1;
+            Device->Health.iRetries++;
+
+            /* Selection inside the retry changes the selected device */
+            TRACE_BEGIN(DS1820_TRACE_RETRY, iHandle);
+            States[i] = DeviceRead(iHandle);
+            TRACE_END(DS1820_TRACE_RETRY, iHandle, States[i]);
+
+            if (States[i] == DS1820_OK) {
+                Device->iFailures = 0;
+                Deferred[i] = -1;
+                Left[i] = 0;
+                iValid++;
+            } else if (RetryCount(States[i]) == 0) {
+                Left[i] = 0;
+            }
+        }
+    }
+
+    /* Convert again only devices which lost power or missed the conversion,
+     * retries are over so Left marks devices to convert */
+    for (i = 0; (i < iDeferred) && (DelayFunc) && (!Bus.iFault); i++) {
+        Left[i] = 0;
+        if ((Deferred[i] < 0) || (iReconvert >= RetryPolicy.iReconvert)) continue;
+        if ((States[i] != DS1820_POWER_ON_RESET) && (States[i] != DS1820_STALE)) continue;
+
+        Left[i] = 1;
+        iReconvert++;
+    }
+
+    if (iReconvert) Reconvert(Deferred, Left, iDeferred);
+
+    for (i = 0; (i < iDeferred) && (iReconvert) && (!Bus.iFault); i++) {
+        if (Left[i] == 0) continue;
+
+        States[i] = DeviceRead(Deferred[i]);
+        if (States[i] == DS1820_OK) {
+            Bus.Devices[Deferred[i]].iFailures = 0;
+            Deferred[i] = -1;
+            iValid++;
+        }
+    }
+
+    /* Failures caused by bus fault or by a missing convert are not device 
+     * failures */
+    for (i = 0; (i < iDeferred) && (!Bus.iFault); i++)
+        if ((Deferred[i] >= 0) && (States[i] != DS1820_STALE))
+            DeviceBackoff(&Bus.Devices[Deferred[i]]);
+
+    return iValid;
+}
+
+/**
+ * Converts marked devices again and waits until the conversion is done. If
+ * they are the whole device table, one Skip ROM convert is used. Otherwise 
+ * externally powered devices are converted back to back and parasite powered
+ * devices one at a time, because the next convert ends strong pull-up of the
+ * previous device. Every parasite powered device keeps strong pull-up for the
+ * whole conversion time, the first one shares it with the others.
+ * @param Deferred Device handles, negative ones are skipped.
+ * @param Left Marks devices to convert, cleared if convert failed.
+ * @param iDeferred Number of devices.
+ */
+void Reconvert(const int *Deferred, uint8_t *Left, int iDeferred) {
+    int i, iCount = 0;
+    uint8_t Marked[DS1820_MAX_DEVICES] = {0};
+    uint8_t bWait = 0;
+    DS1820_Device *Device;
+
+    for (i = 0; i < iDeferred; i++)
+        if ((Left[i]) && (!Marked[Deferred[i]])) {
+            Marked[Deferred[i]] = 1;
+            iCount++;
+        }
+
+    /* Whole table at once */
+    if ((iCount > 1) && (iCount == Bus.iDeviceCount)) {
+        if (DeviceConvert(DS1820_ADDRESS_ALL, 0) == DS1820_OK) {
+            DelayFunc(DS1820_CONVERSION_TIME);
+        } else {
+            for (i = 0; i < iDeferred; i++) Left[i] = 0;
+        }
+        return;
+    }
+
+    /* Externally powered devices convert without the bus */
+    for (i = 0; i < iDeferred; i++) {
+        if (Left[i] == 0) continue;
+        Device = &Bus.Devices[Deferred[i]];
+        if (StrongPullUpRequired(Device->iAddress, Device)) continue;
+
+        if (DeviceConvert(Device->iAddress, Device) == DS1820_OK) bWait = 1;
+        else Left[i] = 0;
+    }
+
+    /* Parasite powered devices one at a time */
+    for (i = 0; i < iDeferred; i++) {
+        if (Left[i] == 0) continue;
+        Device = &Bus.Devices[Deferred[i]];
+        if (!StrongPullUpRequired(Device->iAddress, Device)) continue;
+
+        if (DeviceConvert(Device->iAddress, Device) == DS1820_OK) {
+            DelayFunc(DS1820_CONVERSION_TIME);
+            bWait = 0;
+        } else {
+            Left[i] = 0;
+        }
+    }
+
+    if (bWait) DelayFunc(DS1820_CONVERSION_TIME);
+}
+
+/**
+ * Reads temperature of device once and passes valid reading to consumers.
+ * Shorted or open bus latches bus fault, callers skip the rest of the pass.
+ * Devices missing presence one after another may have left the bus, so open
+ * bus is latched only if no device answers a plain reset either.
+ * @param iHandle Device handle.
+ * @return DS1820_OK if reading was valid, error state otherwise.
+ */
+DS1820_State DeviceRead(int iHandle) {
+    int i, iTemp = 0;
+    uint32_t iTime, iStart;
+    DS1820_State iState;
+    DS1820_Device *Device = &Bus.Devices[iHandle];
+
+    iStart = DS1820_TickGet();
+
+    iState = DeviceTemperatureRead(Device->iAddress, Device, &iTemp);
+
+    iTime = DS1820_TickGet();
+    LatencyRecord(Device, iTime - iStart);
+
+    /* Latch bus fault, the rest of the batch would fail the same way */
+    if (iState == DS1820_NO_PRESENCE) {
+        if (++Bus.iAbsent >= DS1820_FAULT_ABSENT) {
+            if (BusReset() == OW_NO_DEV) Bus.iFault = DS1820_NO_PRESENCE;
+            else Bus.iAbsent = 0;
+        }
+    } else {
+        Bus.iAbsent = 0;
+        if (iState == DS1820_BUS_SHORT) Bus.iFault = DS1820_BUS_SHORT;
+    }
+
+    if (iState != DS1820_OK) return iState;
+
+    for (i = 0; i < iSinkCount; i++) Sinks[i](iHandle, iTime, iTemp);
+
+    return DS1820_OK;
+}
+
+/**
+ * Returns number of retries allowed by the retry policy for failure.
+ * @param iState Failure.
+ * @return Number of retries.
+ */
+uint8_t RetryCount(DS1820_State iState) {
+    switch (iState) {
+        case DS1820_NO_PRESENCE: return RetryPolicy.iNoPresence;
+        case DS1820_CRC_ERROR: return RetryPolicy.iCRC;
+        case DS1820_NO_DEVICE: return RetryPolicy.iNoDevice;
+        default: return 0;
+    }
+}
+
+/**
+ * Doubles number of passes the device sits out after consecutive failures.
+ * @param Device Device table entry.
+ */
+void DeviceBackoff(DS1820_Device *Device) {
+    if (Device->iFailures <= RetryPolicy.iBackoffLimit) Device->iFailures++;
+
+    Device->iSkip = (uint8_t) ((1 << (Device->iFailures - 1)) - 1);
+}
+
+/**
+ * Starts temperature conversion on selected device(s).
+ * @param iAddress 64bit device address or DS1820_ADDRESS_ALL.
+ * @param Device Device table entry or NULL if not in table.
+ * @return DS1820_OK if successfull, DS1820_ERROR if failed.
+ */
+DS1820_State DeviceConvert(uint64_t iAddress, DS1820_Device *Device) {
+    int i;
+
+    /* Ready bus for communcation */
+    BusWeakPullUp();
+
+    /* Device selection */
+    if (BusMatch(iAddress) == OW_NO_DEV) return DS1820_ERROR;
+
+    /* Issue convert temperature command */
+    TemperatureConvert();
+
+    /* Remember which devices hold fresh conversion */
+    if (iAddress == DS1820_ADDRESS_ALL) {
+        for (i = 0; i < Bus.iDeviceCount; i++) Bus.Devices[i].iFlags |= DEVICE_CONVERTED;
+    } else if (Device) {
+        Device->iFlags |= DEVICE_CONVERTED;
+    }
+
+    /* Power up device */
+    if (StrongPullUpRequired(iAddress, Device)) BusStrongPullUp();
+
+    return DS1820_OK;
+}
+
+/**
+ * Reads temperature of selected device, power-on value and stale conversion
+ * are returned as temperature but reported. Conversion is stale if the device
+ * was not addressed by any convert since it was read last time, this is known
+ * only for devices in the device table.
+ * @param iAddress 64bit device address or DS1820_ADDRESS_ALL.
+ * @param Device Device table entry or NULL if not in table.
+ * @param iTemp Output for temperature in degrees of Celsius * 10.
+ * @return DS1820_OK if successfull, DS1820_POWER_ON_RESET if device holds its
+ * power-on value, DS1820_STALE if the conversion was already read, error 
+ * state of DeviceScratchPadRead otherwise.
+ */
+DS1820_State DeviceTemperatureRead(uint64_t iAddress, DS1820_Device *Device, int *iTemp) {
+    int32_t iValue, iPerC;
+    int16_t iRegister;
+    uint8_t iSPad[SCRATCHPAD_LENGTH];
+    DS1820_State iState;
+
+    /* Ready bus for communcation */
+    BusWeakPullUp();
+
+    /* Select device and read DS1820 scratchpad, fail if CRC do not match */
+    iState = DeviceScratchPadRead(iAddress, Device, iSPad);
+    if (iState != DS1820_OK) return iState;
+
+    /* Temperature register in 0.5 C steps, two's complement */
+    iRegister = (int16_t) (((uint16_t) iSPad[1] << 8) | iSPad[0]);
+    iPerC = iSPad[SCRATCHPAD_PER_C_POS];
+
+    /* High resolution in 1/1000 C: register with 0.5 C bit truncated 
+     * - 0.25 + (COUNT_PER_C - COUNT_REMAIN) / COUNT_PER_C, 
+     * plain register if COUNT_PER_C is not valid */
+    if (iPerC) {
+        iValue = (int32_t) (iRegister & ~1) * 500 - 250;
+        iValue += (1000 * (iPerC - iSPad[SCRATCHPAD_REMAIN_POS])) / iPerC;
+    } else {
+        iValue = (int32_t) iRegister * 500;
+    }
+
+    /* Round to tenths of degree */
+    *iTemp = (int) ((iValue >= 0) ? (iValue + 50) / 100 : -((50 - iValue) / 100));
+
+    /* Device lost power since the last conversion */
+    if (PowerOnSignature(iSPad, Device, *iTemp)) {
+        if (Device) Device->Health.iPowerOnResets++;
+        return DS1820_POWER_ON_RESET;
+    }
+
+    if (Device == 0) return DS1820_OK;
+
+    /* Device did not take part in any conversion since the last reading */
+    if (!(Device->iFlags & DEVICE_CONVERTED)) {
+        Device->Health.iStale++;
+        return DS1820_STALE;
+    }
+
+    Device->iFlags &= ~DEVICE_CONVERTED;
+    Device->iLastTemp = (int16_t) *iTemp;
+
+    return DS1820_OK;
+}
+
+/**
+ * Checks scratchpad for power-on reset signature. Genuine +85 C conversion has
+ * the same signature, it is accepted if the previous reading of the device
+ * was close to it.
+ * @param Buffer Scratchpad.
+ * @param Device Device table entry or NULL if not in table.
+ * @param iTemp Temperature calculated from the scratchpad.
+ * @return 1 if device holds its power-on value, 0 if not.
+ */
+uint8_t PowerOnSignature(const uint8_t *Buffer, DS1820_Device *Device, int iTemp) {
+    if ((Buffer[0] != POR_TEMP_LSB) || (Buffer[1] != POR_TEMP_MSB) ||
+            (Buffer[SCRATCHPAD_REMAIN_POS] != POR_COUNT_REMAIN) ||
+            (Buffer[SCRATCHPAD_PER_C_POS] != POR_COUNT_PER_C)) return 0;
+
+    if ((Device) && (Device->iLastTemp != DS1820_TEMP_ERROR) &&
+            (Device->iLastTemp > iTemp - DS1820_POR_PLAUSIBLE) &&
+            (Device->iLastTemp < iTemp + DS1820_POR_PLAUSIBLE)) return 0;
+
+    return 1;
+}
+
+/**
+ * Reads temperature of selected device.
+ * @param iAddress 64bit device address or DS1820_ADDRESS_ALL.
+ * @param Device Device table entry or NULL if not in table.
+ * @return Temperature in degrees of Celsius * 10 or DS1820_TEMP_ERROR in case 
+ * of an error.
+ */
+int DeviceTemperatureGet(uint64_t iAddress, DS1820_Device *Device) {
+    int iTemp;
+    DS1820_State iState = DeviceTemperatureRead(iAddress, Device, &iTemp);
+
+    return ((iState == DS1820_OK) || (iState == DS1820_STALE)) ? iTemp : DS1820_TEMP_ERROR;
+}
+
+/**
+ * This internal function reads a device scratchpad and calculates CRC.
+ * @param Buffer Scratchpad output
+ * @return 0 if CRC match, 1 if do not.
+ */
+uint8_t ScratchPadRead(uint8_t *Buffer) {
+    int i;
+    uint8_t iCRC = 0;
+
+    TRACE_BEGIN(DS1820_TRACE_READ, iTraceHandle);
+
+    /* Issue read scratchpad command */
+    BusWrite(SCRATCHPAD_READ);
+
+    /* Read scratchpad */
+    for (i = 0; i < SCRATCHPAD_LENGTH; i++) {
+        Buffer[i] = BusRead();
+        /* Calculate CRC */
+        if (i != SCRATCHPAD_CRC_POS)
+            iCRC = OW_CRCCalculate(iCRC, Buffer[i]);
+    }
+    TRACE_END(DS1820_TRACE_READ, iTraceHandle, iCRC != Buffer[SCRATCHPAD_CRC_POS]);
+
+    /* Match CRC */
+    return (iCRC != Buffer[SCRATCHPAD_CRC_POS]);
+}
+
+/**
+ * This internal function write two bytes into a device scratchpad.
+ * @param iThresholdHigh High temperature threshold, MSB is sign bit.
+ * @param iThresholdLow Low temperature threshold, MSB is sign bit.
+ */
+void ScratchPadWrite(uint8_t iThresholdHigh, uint8_t iThresholdLow) {
+    TRACE_BEGIN(DS1820_TRACE_WRITE, iTraceHandle);
+    BusWrite(SCRATCHPAD_WRITE);
+    BusWrite(iThresholdHigh);
+    BusWrite(iThresholdLow);
+    TRACE_END(DS1820_TRACE_WRITE, iTraceHandle, 0);
+}
+
+/**
+ * Store configuration into EEPROM.
+ */
+void ScratchPadStore(void) {
+    TRACE_BEGIN(DS1820_TRACE_STORE, iTraceHandle);
+    BusWrite(SCRATCHPAD_STORE);
+    TRACE_END(DS1820_TRACE_STORE, iTraceHandle, 0);
+}
+
+/**
+ * Recall configuration from EEPROM.
+ */
+void ScratchPadRecall(void) {
+    TRACE_BEGIN(DS1820_TRACE_RECALL, iTraceHandle);
+    BusWrite(SCRATCHPAD_RECALL);
+    TRACE_END(DS1820_TRACE_RECALL, iTraceHandle, 0);
+}
+
+/**
+ * Reads device power supply configuration.
+ * @return DS1820_PARASITE_POWER or DS1820_EXTERNAL_POWER
+ */
+uint8_t PowerSupplyType(void) {
+    uint8_t iType;
+
+    TRACE_BEGIN(DS1820_TRACE_POWER, iTraceHandle);
+    BusWrite(POWER_SUPPLY_READ);
+    iType = (BusRead()) ? DS1820_EXTERNAL_POWER : DS1820_PARASITE_POWER;
+    TRACE_END(DS1820_TRACE_POWER, iTraceHandle, 0);
+
+    return iType;
+}
+
+/**
+ * Starts temperature conversion.
+ */
+void TemperatureConvert(void) {
+    TRACE_BEGIN(DS1820_TRACE_CONVERT, iTraceHandle);
+    BusWrite(0x44);
+    TRACE_END(DS1820_TRACE_CONVERT, iTraceHandle, 0);
+}
+
+/**
+ * Finds device in the device table.
+ * @param iAddress 64bit device address.
+ * @return Pointer to device table entry or NULL if not found.
+ */
+DS1820_Device *DeviceFind(uint64_t iAddress) {
+    int iHandle = DS1820_DeviceHandle(iAddress);
+
+    return (iHandle >= 0) ? &Bus.Devices[iHandle] : 0;
+}
+
+/**
+ * Resets the bus and selects device by ROM match, or all devices by Skip ROM.
+ * @param iAddress 64bit device address or DS1820_ADDRESS_ALL.
+ * @return Zero if successfull, OW_NO_DEV if no device is present.
+ */
+uint8_t BusMatch(uint64_t iAddress) {
+    uint8_t iResult;
+
+    TRACE_SELECT(iAddress);
+    TRACE_BEGIN(DS1820_TRACE_MATCH, iTraceHandle);
+    iResult = OW_ROMMatch(iAddress);
+    TRACE_END(DS1820_TRACE_MATCH, iTraceHandle, iResult);
+
+    if (iAddress == DS1820_ADDRESS_ALL) {
+        CAPTURE(DS1820_CAPTURE_SKIP, iResult, 0);
+    } else {
+        CAPTURE(DS1820_CAPTURE_MATCH, iResult, iAddress);
+    }
+
+    /* Reset, ROM command and address if any, only reset without presence */
+    METRIC_BUS(DS1820_BUS_RESET, iResetTime);
+    if (iResult == OW_OK) {
+        METRIC_BUS(DS1820_BUS_WRITE, iSlotTime * ((iAddress == DS1820_ADDRESS_ALL) ? 8 : 72));
+    }
+
+    return iResult;
+}
+
+/**
+ * Resets the bus.
+ */
+uint8_t BusReset(void) {
+    uint8_t iResult = OW_Reset();
+
+    CAPTURE(DS1820_CAPTURE_RESET, iResult, 0);
+    METRIC_BUS(DS1820_BUS_RESET, iResetTime);
+
+    return iResult;
+}
+
+/**
+ * Writes one byte to the bus.
+ * @param iByte Byte to be written.
+ */
+void BusWrite(uint8_t iByte) {
+    OW_ByteWrite(iByte);
+    CAPTURE(DS1820_CAPTURE_WRITE, iByte, 0);
+    METRIC_BUS(DS1820_BUS_WRITE, iSlotTime * 8);
+}
+
+/**
+ * Reads one byte from the bus.
+ * @return Byte read.
+ */
+uint8_t BusRead(void) {
+    uint8_t iByte = OW_ByteRead();
+
+    CAPTURE(DS1820_CAPTURE_READ, iByte, 0);
+    METRIC_BUS(DS1820_BUS_READ, iSlotTime * 8);
+
+    return iByte;
+}
+
+/**
+ * Ends strong pull-up, if active, and sets communication pin to WeakPullUp.
+ */
+void BusWeakPullUp(void) {
+#ifdef DS1820_METRICS_ENABLE
+    if (bPullUp) METRIC_BUS(DS1820_BUS_PULLUP, (DS1820_TickGet() - iPullUpStart) * 1000);
+    bPullUp = 0;
+#endif
+    OW_WeakPullUp();
+    CAPTURE(DS1820_CAPTURE_WEAK, 0, 0);
+}
+
+/**
+ * Sets communication pin to StrongPullUp, it lasts until the next 
+ * BusWeakPullUp.
+ */
+void BusStrongPullUp(void) {
+    OW_StrongPullUp();
+    CAPTURE(DS1820_CAPTURE_STRONG, 0, 0);
+#ifdef DS1820_METRICS_ENABLE
+    iPullUpStart = DS1820_TickGet();
+    bPullUp = 1;
+#endif
+}
+
+/**
+ * Searches for the first device of given family.
+ * @param iFamily Family code, 0 for any device.
+ * @return 64bit device address or 0 if no device was found.
+ */
+uint64_t BusSearchFirst(uint8_t iFamily) {
+    uint64_t iAddress = OW_SearchFirst(iFamily);
+
+    CAPTURE(DS1820_CAPTURE_SEARCH_FIRST, iFamily, iAddress);
+
+    /* Reset, search command and 64 bit triplets */
+    METRIC_BUS(DS1820_BUS_RESET, iResetTime);
+    METRIC_BUS(DS1820_BUS_WRITE, iSlotTime * (8 + 64));
+    METRIC_BUS(DS1820_BUS_READ, iSlotTime * 128);
+
+    return iAddress;
+}
+
+/**
+ * Searches for the next device.
+ * @return 64bit device address or 0 if there are no more devices.
+ */
+uint64_t BusSearchNext(void) {
+    uint64_t iAddress = OW_SearchNext();
+
+    CAPTURE(DS1820_CAPTURE_SEARCH_NEXT, 0, iAddress);
+    METRIC_BUS(DS1820_BUS_RESET, iResetTime);
+    METRIC_BUS(DS1820_BUS_WRITE, iSlotTime * (8 + 64));
+    METRIC_BUS(DS1820_BUS_READ, iSlotTime * 128);
+
+    return iAddress;
+}
+
+/**
+ * Selects device for reading. Skip ROM is used instead of 64bit ROM match 
+ * when the last search found exactly one device on the bus. 
+ * @param iAddress 64bit device address or DS1820_ADDRESS_ALL.
+ * @return Zero if successfull, OW_NO_DEV if no device is present.
+ */
+uint8_t DeviceSelect(uint64_t iAddress) {
+    if ((Bus.iFlags & BUS_SINGLE) && (iAddress == Bus.Devices[Bus.iSingle].iAddress))
+        return BusMatch(DS1820_ADDRESS_ALL);
+
+    return BusMatch(iAddress);
+}
+
+/**
+ * Selects device and reads its scratchpad. Overdrive capable devices are read
+ * at overdrive speed, device is read again at standard speed and its overdrive
+ * capability is dropped if it does not answer at overdrive speed. Overdrive is
+ * tried again after DS1820_OVERDRIVE_REPROBE valid standard speed reads. Bus 
+ * without presence is not an overdrive failure.
+ * @param iAddress 64bit device address or DS1820_ADDRESS_ALL.
+ * @param Device Device table entry or NULL if not in table.
+ * @param Buffer Scratchpad output
+ * @return DS1820_OK if successfull, DS1820_NO_PRESENCE if no device answered
+ * reset, DS1820_BUS_SHORT if all bits read zero, DS1820_NO_DEVICE if all bits
+ * read one, DS1820_CRC_ERROR if CRC do not match.
+ */
+DS1820_State DeviceScratchPadRead(uint64_t iAddress, DS1820_Device *Device, uint8_t *Buffer) {
+    DS1820_State iState, iFill;
+
+#ifdef OW_SPEED_OVERDRIVE
+    if ((Device) && (Device->iFlags & DEVICE_OVERDRIVE) && !OverdriveSelect(iAddress)) {
+        if (!ScratchPadRead(Buffer) && (ScratchPadFill(Buffer) == DS1820_OK)) {
+            BusSpeedSet(OW_SPEED_STANDARD);
+            Device->Health.iReads++;
+            return DS1820_OK;
+        }
+
+        /* Fall back to standard speed until reprobe */
+        BusSpeedSet(OW_SPEED_STANDARD);
+        Device->iFlags = (Device->iFlags & ~DEVICE_OVERDRIVE) | DEVICE_OVERDRIVE_LOST;
+        Device->iStandardReads = 0;
+    }
+#endif
+
+    if (Device) Device->Health.iReads++;
+
+    if (DeviceSelect(iAddress)) {
+        if (Device) Device->Health.iPresenceErrors++;
+        return DS1820_NO_PRESENCE;
+    }
+
+    iState = (ScratchPadRead(Buffer)) ? DS1820_CRC_ERROR : DS1820_OK;
+
+    /* All zeros pass CRC, stuck bus is checked regardless of CRC */
+    iFill = ScratchPadFill(Buffer);
+    if (iFill != DS1820_OK) iState = iFill;
+
+    if (Device) {
+        if (iState == DS1820_CRC_ERROR) Device->Health.iCRCErrors++;
+        if (iState == DS1820_NO_DEVICE) Device->Health.iPresenceErrors++;
+    }
+
+#ifdef OW_SPEED_OVERDRIVE
+    /* Try overdrive again with the next read */
+    if ((Device) && (iState == DS1820_OK) && (Device->iFlags & DEVICE_OVERDRIVE_LOST) &&
+            (++Device->iStandardReads >= DS1820_OVERDRIVE_REPROBE))
+        Device->iFlags = (Device->iFlags & ~DEVICE_OVERDRIVE_LOST) | DEVICE_OVERDRIVE;
+#endif
+
+    return iState;
+}
+
+/**
+ * Checks scratchpad for bus stuck in one state.
+ * @param Buffer Scratchpad.
+ * @return DS1820_BUS_SHORT if all bytes are zero, DS1820_NO_DEVICE if all 
+ * bytes are 0xFF, DS1820_OK otherwise.
+ */
+DS1820_State ScratchPadFill(const uint8_t *Buffer) {
+    int i;
+    uint8_t iOr = 0, iAnd = 0xFF;
+
+    for (i = 0; i < SCRATCHPAD_LENGTH; i++) {
+        iOr |= Buffer[i];
+        iAnd &= Buffer[i];
+    }
+
+    if (iOr == 0x00) return DS1820_BUS_SHORT;
+    if (iAnd == 0xFF) return DS1820_NO_DEVICE;
+
+    return DS1820_OK;
+}
+
+#ifdef OW_SPEED_OVERDRIVE
+
+/**
+ * Selects device by Overdrive Match ROM. Transport is left at overdrive speed,
+ * next standard speed reset returns all devices back to standard speed.
+ * @param iAddress 64bit device address.
+ * @return 0 if successfull, nonzero if no device answered reset, transport is
+ * left at standard speed then.
+ */
+uint8_t OverdriveSelect(uint64_t iAddress) {
+    int i;
+
+    TRACE_SELECT(iAddress);
+    TRACE_BEGIN(DS1820_TRACE_MATCH, iTraceHandle);
+
+    BusSpeedSet(OW_SPEED_STANDARD);
+    if (BusReset()) {
+        TRACE_END(DS1820_TRACE_MATCH, iTraceHandle, OW_NO_DEV);
+        return OW_NO_DEV;
+    }
+    BusWrite(OVERDRIVE_MATCH_ROM);
+
+    /* Address is sent at overdrive speed already */
+    BusSpeedSet(OW_SPEED_OVERDRIVE);
+    for (i = 0; i < 8; i++)
+        BusWrite((uint8_t) (iAddress >> (8 * i)));
+
+    TRACE_END(DS1820_TRACE_MATCH, iTraceHandle, OW_OK);
+
+    return OW_OK;
+}
+
+/**
+ * Sets bus speed.
+ * @param iSpeed OW_SPEED_STANDARD or OW_SPEED_OVERDRIVE.
+ */
+void BusSpeedSet(uint8_t iSpeed) {
+    OW_SpeedSet(iSpeed);
+    CAPTURE(DS1820_CAPTURE_SPEED, iSpeed, 0);
+#ifdef DS1820_METRICS_ENABLE
+    iResetTime = (iSpeed == OW_SPEED_OVERDRIVE) ? DS1820_METRICS_RESET_TIME_OD : DS1820_METRICS_RESET_TIME;
+    iSlotTime = (iSpeed == OW_SPEED_OVERDRIVE) ? DS1820_METRICS_SLOT_TIME_OD : DS1820_METRICS_SLOT_TIME;
+#endif
+}
+
+/**
+ * Checks which devices in the device table answer at overdrive speed and sets
+ * their flags.
+ */
+void OverdriveProbe(void) {
+    int i, j;
+    uint8_t iSPad[SCRATCHPAD_LENGTH];
+    uint8_t iOnes;
+
+    for (i = 0; i < Bus.iDeviceCount; i++) {
+        if (OverdriveSelect(Bus.Devices[i].iAddress)) continue;
+
+        /* Silent bus reads all ones which may pass CRC by chance */
+        if (!ScratchPadRead(iSPad)) {
+            for (j = 0, iOnes = 0xFF; j < SCRATCHPAD_LENGTH; j++) iOnes &= iSPad[j];
+            if (iOnes != 0xFF)
+                Bus.Devices[i].iFlags = (Bus.Devices[i].iFlags & ~DEVICE_OVERDRIVE_LOST) | DEVICE_OVERDRIVE;
+        }
+
+        BusSpeedSet(OW_SPEED_STANDARD);
+        BusReset();
+    }
+}
+
+#endif
+
+/**
+ * Clears device health counters.
+ * @param Device Device table entry.
+ */
+void HealthClear(DS1820_Device *Device) {
+    DS1820_Health Empty = {0};
+
+    Device->Health = Empty;
+}
+
+/**
+ * Adds read latency into device histogram.
+ * @param Device Device table entry.
+ * @param iLatency Read latency in ticks.
+ */
+void LatencyRecord(DS1820_Device *Device, uint32_t iLatency) {
+    int iBucket = 0;
+
+    while ((iLatency) && (iBucket < DS1820_HEALTH_BUCKETS - 1)) {
+        iLatency >>= 1;
+        iBucket++;
+    }
+
+    Device->Health.Latency[iBucket]++;
+}
+
+/**
+ * Decides if StrongPullUp is needed for selected device(s). Only devices and 
+ * buses with known external power supply do not need it.
+ * @param iAddress 64bit device address or DS1820_ADDRESS_ALL.
+ * @param Device Device table entry or NULL if not in table.
+ * @return 1 if StrongPullUp is required, 0 if not.
+ */
+uint8_t StrongPullUpRequired(uint64_t iAddress, DS1820_Device *Device) {
+    if ((Bus.iFlags & BUS_POWER_MAPPED) && !(Bus.iFlags & BUS_PARASITE)) return 0;
+
+    if (iAddress == DS1820_ADDRESS_ALL) return 1;
+
+    if ((Device) && (Device->iFlags & DEVICE_POWER_KNOWN))
+        return (Device->iFlags & DEVICE_PARASITE) ? 1 : 0;
+
+    return 1;
+}
+
+/**
+ * Converts temperature threshold into scratchpad format.
+ * @param iThreshold Temperature threshold, in degrees of Celsius.
+ * @return Threshold byte, MSB is sign bit.
+ */
+uint8_t ThresholdEncode(int iThreshold) {
+    return (iThreshold >= 0) ? (uint8_t) iThreshold & 0x7F : 0x80 | ((uint8_t) iThreshold & 0x7F);
 }
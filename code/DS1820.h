@@ -11,6 +11,10 @@
  *              - Device Power Informations
  *              - Temperature Threshold Configuration
  *          
+ * @note    Overdrive speed is used for overdrive capable devices when the
+ *          OneWire library provides OW_SpeedSet() together with 
+ *          OW_SPEED_STANDARD and OW_SPEED_OVERDRIVE definitions.
+ *          
  * @see     DS1820.c documentation
  *******************************************************************************
  */
@@ -28,37 +32,165 @@ extern "C" {
 #define DS1820_ADDRESS_ALL      0
 #define DS1820_FAMILY_CODE      0x10
 
+    /* Maximum number of devices handled by batch functions */
+#ifndef DS1820_MAX_DEVICES
+#define DS1820_MAX_DEVICES      16
+#endif
+
+    /* Device table index size, power of two at least twice DS1820_MAX_DEVICES */
+#ifndef DS1820_INDEX_SIZE
+#define DS1820_INDEX_SIZE       (2 * DS1820_MAX_DEVICES)
+#endif
+
+    /* Address hash, serial number bits are well distributed already */
+#define DS1820_ADDRESS_HASH(iAddress)   ((uint32_t) ((iAddress) >> 8))
+
+    /* Maximum number of sample consumers of the read engine */
+#ifndef DS1820_MAX_SINKS
+#define DS1820_MAX_SINKS        4
+#endif
+
+    /* Default read engine retry policy, see DS1820_RetryPolicySet */
+#ifndef DS1820_RETRY_NO_PRESENCE
+#define DS1820_RETRY_NO_PRESENCE    1
+#endif
+#ifndef DS1820_RETRY_CRC
+#define DS1820_RETRY_CRC            2
+#endif
+#ifndef DS1820_RETRY_NO_DEVICE
+#define DS1820_RETRY_NO_DEVICE      1
+#endif
+#ifndef DS1820_RETRY_BUDGET
+#define DS1820_RETRY_BUDGET         4
+#endif
+#ifndef DS1820_RETRY_BACKOFF
+#define DS1820_RETRY_BACKOFF        4
+#endif
+#ifndef DS1820_RETRY_RECONVERT
+#define DS1820_RETRY_RECONVERT      2
+#endif
+
+    /* Temperature conversion time in miliseconds */
+#ifndef DS1820_CONVERSION_TIME
+#define DS1820_CONVERSION_TIME      750
+#endif
+
+    /* Power-on value (+85 C) is accepted as temperature only if the previous
+     * reading was closer than this, in degrees of Celsius * 10 */
+#ifndef DS1820_POR_PLAUSIBLE
+#define DS1820_POR_PLAUSIBLE        50
+#endif
+
+    /* Number of read latency histogram buckets, bucket i counts latencies 
+     * from 2^(i-1) to 2^i - 1 ticks, the last one counts all longer */
+#ifndef DS1820_HEALTH_BUCKETS
+#define DS1820_HEALTH_BUCKETS   8
+#endif
+
+    /* Valid standard speed reads after which overdrive is tried again on a
+     * device which failed at overdrive speed */
+#ifndef DS1820_OVERDRIVE_REPROBE
+#define DS1820_OVERDRIVE_REPROBE    16
+#endif
+
+    /* Consecutive devices without presence after which the bus is reset, no
+     * presence latches open bus fault, devices which left the bus do not */
+#ifndef DS1820_FAULT_ABSENT
+#define DS1820_FAULT_ABSENT     2
+#endif
+
     /* Return values definition */
     typedef enum _DS1820_State {
         DS1820_OK = 0,
         DS1820_ERROR = 1,
+        DS1820_NO_PRESENCE = 2,
+        DS1820_CRC_ERROR = 3,
+        DS1820_BUS_SHORT = 4,
+        DS1820_NO_DEVICE = 5,
+        DS1820_POWER_ON_RESET = 6,
+        DS1820_STALE = 7,
+        DS1820_BUSY = 8,
         DS1820_TEMP_ERROR = -10000,
 
         DS1820_PARASITE_POWER = 0x10,
         DS1820_EXTERNAL_POWER = 0x20
     } DS1820_State;
 
+    /* Sample consumer, called by the read engine for every valid reading */
+    typedef void (*DS1820_SampleSink)(int iDevice, uint32_t iTime, int iTemp);
+
+    /* Per device health counters */
+    typedef struct _DS1820_Health {
+        uint32_t iReads;
+        uint32_t iPresenceErrors;
+        uint32_t iCRCErrors;
+        uint32_t iPowerOnResets;
+        uint32_t iStale;
+        uint32_t iRetries;
+        uint32_t iSkipped;
+        uint32_t Latency[DS1820_HEALTH_BUCKETS];
+    } DS1820_Health;
+
+    /* Read engine retry policy, retries are deferred to the end of the pass */
+    typedef struct _DS1820_RetryPolicy {
+        uint8_t iNoPresence;
+        uint8_t iCRC;
+        uint8_t iNoDevice;
+        uint8_t iBudget;
+        uint8_t iBackoffLimit;
+        uint8_t iReconvert;
+    } DS1820_RetryPolicy;
+
     /* Function headers */
     void DS1820_Init(void);
+    void DS1820_DelaySet(void (*Delay)(int iMiliSeconds));
+    void DS1820_TickSet(uint32_t (*Tick)(void));
+    uint32_t DS1820_TickGet(void);
 
     /* Temperature measurement */
     DS1820_State DS1820_TemperatureConvert(uint64_t iAddress);
     int DS1820_TemperatureGet(uint64_t iAddress);
+    DS1820_State DS1820_TemperatureConvertHandle(int iHandle);
+    int DS1820_TemperatureGetHandle(int iHandle);
+    DS1820_State DS1820_TemperatureRead(uint64_t iAddress, int *iTemp);
 
     /* Alarms */
     DS1820_State DS1820_TemperatureAlarmSet(uint64_t iAddress, int iHigh, int iLow);
+    DS1820_State DS1820_TemperatureAlarmSetMany(uint64_t *Addresses, int *iHigh, int *iLow, int iCount, int bVerify);
     DS1820_State DS1820_TemperatureAlarmGet(uint64_t iAddress, int *iHigh, int *iLow);
 
     /* Configuration */
     DS1820_State DS1820_ConfigurationStore(uint64_t iAddress);
     DS1820_State DS1820_ConfigurationRecall(uint64_t iAddress);
+    DS1820_State DS1820_ConfigurationStoreDirty(uint64_t *Addresses, int iCount, int *iStored);
 
     /* Device info */
     DS1820_State DS1820_PowerTypeGet(uint64_t iAddress);
+    DS1820_State DS1820_PowerMapBuild(void);
 
     /* Device discovery */
     int DS1820_Search(uint64_t *Addresses, int iMaxDevices);
 
+    /* Device table */
+    int DS1820_DeviceAdd(uint64_t iAddress);
+    int DS1820_DeviceHandle(uint64_t iAddress);
+    void DS1820_DeviceClear(void);
+    int DS1820_DeviceCount(void);
+    uint64_t DS1820_DeviceAddress(int iHandle);
+
+    /* Read engine */
+    DS1820_State DS1820_SampleSinkAdd(DS1820_SampleSink Sink);
+    int DS1820_TemperatureReadAll(void);
+    int DS1820_TemperatureReadList(const int *Handles, int iCount);
+    DS1820_State DS1820_TemperatureReadHandle(int iHandle);
+    void DS1820_RetryPolicySet(const DS1820_RetryPolicy *Policy);
+    DS1820_State DS1820_BusFault(void);
+    void DS1820_BusFaultClear(void);
+
+    /* Device health */
+    DS1820_State DS1820_HealthGet(int iHandle, DS1820_Health *Health);
+    void DS1820_HealthReset(int iHandle);
+
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,207 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Adaptive.c
+ * @author  Vojtech Vigner
+ * @brief   Adaptive per device sampling rate, fast changing devices are read
+ *          more often than stable ones within a global bus time budget.
+ * 
+ * @attention   
+ *          Activity of every device is an exponential moving average of its 
+ *          absolute temperature change per second, it covers both slope and 
+ *          noise. Reading period is halved when expected change per period
+ *          reaches 2 LSB (0.2 degree) and doubled when it drops below 0.5 LSB,
+ *          always within minimal and maximal period. When the sum of 
+ *          read cost / period of all devices exceeds the budget, all periods 
+ *          are stretched by the same factor.
+ * 
+ * @verbatim
+ *          ********************************************************************
+ *                                How to use this module
+ *          ********************************************************************
+ *          1. Set periods, read cost and budget by DS1820_AdaptiveInit.
+ * 
+ *          2. Register DS1820_AdaptiveSink by DS1820_SampleSinkAdd.
+ *
+ *          3. Periodically start conversion, get devices due for reading by 
+ *          DS1820_AdaptiveDue and read them by DS1820_TemperatureReadList.
+ *          DS1820_AdaptiveWait tells how long to sleep.
+ *  @endverbatim  
+ *******************************************************************************
+ */
+#include "DS1820_Adaptive.h"
+
+/* Fixed point fraction bits of activity */
+#define ACTIVITY_SHIFT      4
+
+/* Moving average weight of new value, 1 / 2^ACTIVITY_WEIGHT */
+#define ACTIVITY_WEIGHT     2
+
+/* Device state flags */
+#define RATE_SAMPLED        0x01
+
+typedef struct _DS1820_Rate {
+    uint32_t iLast;
+    uint32_t iPeriod;
+    uint32_t iActivity;
+    int16_t iTemp;
+    uint8_t iFlags;
+} DS1820_Rate;
+
+static DS1820_Rate Rates[DS1820_MAX_DEVICES];
+static uint32_t iMinimalPeriod = 1000;
+static uint32_t iMaximalPeriod = 60000;
+static uint32_t iCost = 15;
+static uint32_t iBudgetPerMille = 500;
+
+/* Internal functions */
+static uint32_t PeriodScale(void);
+
+/**
+ * Sets sampling limits and clears state of all devices, all devices start at
+ * minimal period.
+ * @param iMinPeriod Minimal reading period in tick units (see DS1820_TickSet).
+ * @param iMaxPeriod Maximal reading period in tick units.
+ * @param iReadCost Bus time of one reading in tick units.
+ * @param iBudget Maximal bus utilisation by readings in per mille.
+ */
+void DS1820_AdaptiveInit(uint32_t iMinPeriod, uint32_t iMaxPeriod, uint32_t iReadCost, uint32_t iBudget) {
+    int i;
+
+    iMinimalPeriod = (iMinPeriod) ? iMinPeriod : 1;
+    iMaximalPeriod = (iMaxPeriod > iMinimalPeriod) ? iMaxPeriod : iMinimalPeriod;
+    iCost = iReadCost;
+    iBudgetPerMille = (iBudget) ? iBudget : 1;
+
+    for (i = 0; i < DS1820_MAX_DEVICES; i++) {
+        Rates[i].iPeriod = iMinimalPeriod;
+        Rates[i].iActivity = 0;
+        Rates[i].iFlags = 0;
+    }
+}
+
+/**
+ * Finds devices from the device table which are due for reading.
+ * @param iNow Current time in tick units.
+ * @param Handles Output array of device handles.
+ * @param iMax Output array length.
+ * @return Number of devices due.
+ */
+int DS1820_AdaptiveDue(uint32_t iNow, int *Handles, int iMax) {
+    int i, iCount = 0, iDevices = DS1820_DeviceCount();
+    uint32_t iScale = PeriodScale();
+    DS1820_Rate *Rate;
+
+    for (i = 0; (i < iDevices) && (i < DS1820_MAX_DEVICES) && (iCount < iMax); i++) {
+        Rate = &Rates[i];
+
+        if (!(Rate->iFlags & RATE_SAMPLED) ||
+                (iNow - Rate->iLast >= (uint32_t) (((uint64_t) Rate->iPeriod * iScale) / 1000)))
+            Handles[iCount++] = i;
+    }
+
+    return iCount;
+}
+
+/**
+ * Returns time until the next device is due.
+ * @param iNow Current time in tick units.
+ * @return Time in tick units, 0 if a device is due already.
+ */
+uint32_t DS1820_AdaptiveWait(uint32_t iNow) {
+    int i, iDevices = DS1820_DeviceCount();
+    uint32_t iScale = PeriodScale();
+    uint32_t iWait = iMaximalPeriod, iPeriod, iElapsed;
+
+    for (i = 0; (i < iDevices) && (i < DS1820_MAX_DEVICES); i++) {
+        if (!(Rates[i].iFlags & RATE_SAMPLED)) return 0;
+
+        iPeriod = (uint32_t) (((uint64_t) Rates[i].iPeriod * iScale) / 1000);
+        iElapsed = iNow - Rates[i].iLast;
+
+        if (iElapsed >= iPeriod) return 0;
+        if (iPeriod - iElapsed < iWait) iWait = iPeriod - iElapsed;
+    }
+
+    return iWait;
+}
+
+/**
+ * Read engine consumer, updates device activity and period, see 
+ * DS1820_SampleSinkAdd.
+ * @param iDevice Device handle.
+ * @param iTime Sample timestamp.
+ * @param iTemp Temperature in degrees of Celsius * 10.
+ */
+void DS1820_AdaptiveSink(int iDevice, uint32_t iTime, int iTemp) {
+    DS1820_Rate *Rate;
+    uint32_t iElapsed, iChange, iRate, iExpected;
+
+    if ((iDevice < 0) || (iDevice >= DS1820_MAX_DEVICES)) return;
+
+    Rate = &Rates[iDevice];
+
+    if (Rate->iPeriod == 0) Rate->iPeriod = iMinimalPeriod;
+
+    if (Rate->iFlags & RATE_SAMPLED) {
+        iElapsed = iTime - Rate->iLast;
+        if (iElapsed == 0) return;
+
+        /* Absolute change per 1000 ticks, fixed point */
+        iChange = (uint32_t) ((iTemp > Rate->iTemp) ? iTemp - Rate->iTemp : Rate->iTemp - iTemp);
+        iRate = (uint32_t) (((uint64_t) iChange * 1000 << ACTIVITY_SHIFT) / iElapsed);
+
+        Rate->iActivity += ((int32_t) (iRate - Rate->iActivity)) >> ACTIVITY_WEIGHT;
+
+        /* Expected change per period, fixed point */
+        iExpected = (uint32_t) (((uint64_t) Rate->iActivity * Rate->iPeriod) / 1000);
+
+        if ((iExpected >= (2U << ACTIVITY_SHIFT)) && (Rate->iPeriod > iMinimalPeriod)) {
+            Rate->iPeriod /= 2;
+            if (Rate->iPeriod < iMinimalPeriod) Rate->iPeriod = iMinimalPeriod;
+        } else if ((iExpected < (1U << (ACTIVITY_SHIFT - 1))) && (Rate->iPeriod < iMaximalPeriod)) {
+            Rate->iPeriod *= 2;
+            if (Rate->iPeriod > iMaximalPeriod) Rate->iPeriod = iMaximalPeriod;
+        }
+    }
+
+    Rate->iLast = iTime;
+    Rate->iTemp = (int16_t) iTemp;
+    Rate->iFlags |= RATE_SAMPLED;
+}
+
+/**
+ * Returns requested reading period of device, before budget stretching.
+ * @param iDevice Device handle.
+ * @return Period in tick units or 0 if handle is invalid.
+ */
+uint32_t DS1820_AdaptivePeriod(int iDevice) {
+    if ((iDevice < 0) || (iDevice >= DS1820_MAX_DEVICES)) return 0;
+
+    return Rates[iDevice].iPeriod;
+}
+
+/**
+ * Returns bus utilisation requested by all devices.
+ * @return Utilisation in per mille, may exceed the budget.
+ */
+uint32_t DS1820_AdaptiveLoad(void) {
+    int i, iDevices = DS1820_DeviceCount();
+    uint32_t iLoad = 0;
+
+    for (i = 0; (i < iDevices) && (i < DS1820_MAX_DEVICES); i++)
+        iLoad += (iCost * 1000) / ((Rates[i].iPeriod) ? Rates[i].iPeriod : iMinimalPeriod);
+
+    return iLoad;
+}
+
+/**
+ * Calculates period stretching factor keeping load within the budget.
+ * @return Factor in per mille, at least 1000.
+ */
+uint32_t PeriodScale(void) {
+    uint32_t iLoad = DS1820_AdaptiveLoad();
+
+    if (iLoad <= iBudgetPerMille) return 1000;
+
+    return (uint32_t) (((uint64_t) iLoad * 1000) / iBudgetPerMille);
+}
@@ -0,0 +1,39 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Adaptive.h
+ * @author  Vojtech Vigner
+ * @brief   Adaptive per device sampling rate, fast changing devices are read
+ *          more often than stable ones within a global bus time budget.
+ *          
+ * @see     DS1820_Adaptive.c documentation
+ *******************************************************************************
+ */
+
+#ifndef DS1820_ADAPTIVE_H
+#define	DS1820_ADAPTIVE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "DS1820.h"
+
+    /* Configuration */
+    void DS1820_AdaptiveInit(uint32_t iMinPeriod, uint32_t iMaxPeriod, uint32_t iReadCost, uint32_t iBudget);
+
+    /* Scheduling */
+    int DS1820_AdaptiveDue(uint32_t iNow, int *Handles, int iMax);
+    uint32_t DS1820_AdaptiveWait(uint32_t iNow);
+    void DS1820_AdaptiveSink(int iDevice, uint32_t iTime, int iTemp);
+
+    /* Results */
+    uint32_t DS1820_AdaptivePeriod(int iDevice);
+    uint32_t DS1820_AdaptiveLoad(void);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DS1820_ADAPTIVE_H */
+
@@ -0,0 +1,96 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Capture.c
+ * @author  Vojtech Vigner
+ * @brief   Capture of DS1820 bus operations into compact binary records for
+ *          later replay on the host. Compiled in only if DS1820_CAPTURE_ENABLE
+ *          is defined.
+ *
+ * @attention
+ *          DS1820.c records every reset, ROM match, written and read byte,
+ *          pull-up change, search step and speed change together with results
+ *          returned by the OneWire library. Record is operation code, time
+ *          since the previous record as unsigned LEB128 varint in
+ *          DS1820_CAPTURE_TIME units and payload listed at DS1820_CaptureOp,
+ *          addresses are 8 bytes little endian. Byte transfer within one tick
+ *          takes 3 bytes. Records are passed whole to the writer, the first
+ *          one is the start record with format version. Without
+ *          DS1820_CAPTURE_ENABLE the hooks are empty macros and this file is
+ *          not needed.
+ *
+ * @verbatim
+ *          ********************************************************************
+ *                                How to use this module
+ *          ********************************************************************
+ *          1. Define DS1820_CAPTURE_ENABLE for DS1820.c and this file.
+ *
+ *          2. Start capture by DS1820_CaptureSet with writer storing records
+ *          into a file (flash, UART, ...), stop it by DS1820_CaptureSet(0).
+ *
+ *          3. Load the file on the host by OW_ReplayLoad and link
+ *          sim/OneWire_Replay.c instead of the OneWire library.
+ *  @endverbatim
+ *******************************************************************************
+ */
+#include "DS1820_Capture.h"
+
+#ifdef DS1820_CAPTURE_ENABLE
+
+/* Payload flags of operations */
+#define PAYLOAD_BYTE        0x01
+#define PAYLOAD_ADDRESS     0x02
+
+static const uint8_t Payloads[] = {
+    PAYLOAD_BYTE, PAYLOAD_BYTE, PAYLOAD_BYTE | PAYLOAD_ADDRESS, PAYLOAD_BYTE,
+    PAYLOAD_BYTE, PAYLOAD_BYTE, 0, 0, PAYLOAD_BYTE | PAYLOAD_ADDRESS,
+    PAYLOAD_ADDRESS, PAYLOAD_BYTE
+};
+
+static DS1820_CaptureWriter WriterFunc = 0;
+static uint32_t iLastTime;
+
+/**
+ * Starts capture and writes start record, or stops capture.
+ * @param Writer Record consumer, NULL to stop capture.
+ */
+void DS1820_CaptureSet(DS1820_CaptureWriter Writer) {
+    WriterFunc = Writer;
+    iLastTime = DS1820_CAPTURE_TIME();
+
+    DS1820_CaptureRecord(DS1820_CAPTURE_START, DS1820_CAPTURE_VERSION, 0);
+}
+
+/**
+ * Encodes one record and passes it to the writer, called by DS1820.c hooks.
+ * @param iOp Operation, DS1820_CaptureOp.
+ * @param iByte Written or read byte, result, family code or speed.
+ * @param iAddress Device address, used by operations with address payload.
+ */
+void DS1820_CaptureRecord(uint8_t iOp, uint8_t iByte, uint64_t iAddress) {
+    uint8_t Record[DS1820_CAPTURE_RECORD_MAX];
+    uint32_t iTime, iDelta;
+    int i, iLength = 0;
+
+    if ((WriterFunc == 0) || (iOp >= sizeof (Payloads))) return;
+
+    iTime = DS1820_CAPTURE_TIME();
+    iDelta = iTime - iLastTime;
+    iLastTime = iTime;
+
+    Record[iLength++] = iOp;
+
+    /* Time delta, 7 bits per byte, the lowest first */
+    do {
+        Record[iLength++] = (uint8_t) ((iDelta & 0x7F) | ((iDelta > 0x7F) ? 0x80 : 0));
+        iDelta >>= 7;
+    } while (iDelta);
+
+    if (Payloads[iOp] & PAYLOAD_BYTE) Record[iLength++] = iByte;
+
+    if (Payloads[iOp] & PAYLOAD_ADDRESS)
+        for (i = 0; i < 8; i++) Record[iLength++] = (uint8_t) (iAddress >> (8 * i));
+
+    WriterFunc(Record, iLength);
+}
+
+#endif
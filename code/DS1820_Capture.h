@@ -0,0 +1,61 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Capture.h
+ * @author  Vojtech Vigner
+ * @brief   Capture of DS1820 bus operations into compact binary records for
+ *          later replay on the host. Compiled in only if DS1820_CAPTURE_ENABLE
+ *          is defined.
+ *
+ * @see     DS1820_Capture.c documentation
+ *******************************************************************************
+ */
+
+#ifndef DS1820_CAPTURE_H
+#define	DS1820_CAPTURE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "DS1820.h"
+
+    /* Record format version, stored in the start record */
+#define DS1820_CAPTURE_VERSION  1
+
+    /* Longest record: operation, 5 byte time delta, byte and address */
+#define DS1820_CAPTURE_RECORD_MAX   15
+
+    /* Record timestamp source, replay returns it as tick */
+#ifndef DS1820_CAPTURE_TIME
+#define DS1820_CAPTURE_TIME()   DS1820_TickGet()
+#endif
+
+    /* Operations, record payload is in brackets */
+    typedef enum _DS1820_CaptureOp {
+        DS1820_CAPTURE_START = 0,           /* [version] */
+        DS1820_CAPTURE_RESET = 1,           /* [result] */
+        DS1820_CAPTURE_MATCH = 2,           /* [result, address] */
+        DS1820_CAPTURE_SKIP = 3,            /* [result] */
+        DS1820_CAPTURE_WRITE = 4,           /* [byte] */
+        DS1820_CAPTURE_READ = 5,            /* [byte] */
+        DS1820_CAPTURE_WEAK = 6,            /* [] */
+        DS1820_CAPTURE_STRONG = 7,          /* [] */
+        DS1820_CAPTURE_SEARCH_FIRST = 8,    /* [family, address] */
+        DS1820_CAPTURE_SEARCH_NEXT = 9,     /* [address] */
+        DS1820_CAPTURE_SPEED = 10           /* [speed] */
+    } DS1820_CaptureOp;
+
+    /* Record consumer, e.g. writing into file or UART */
+    typedef void (*DS1820_CaptureWriter)(const uint8_t *Data, int iLength);
+
+    /* Recording */
+    void DS1820_CaptureSet(DS1820_CaptureWriter Writer);
+    void DS1820_CaptureRecord(uint8_t iOp, uint8_t iByte, uint64_t iAddress);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DS1820_CAPTURE_H */
+
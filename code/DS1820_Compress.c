@@ -0,0 +1,285 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Compress.c
+ * @author  Vojtech Vigner
+ * @brief   Bit packed compression of temperature time series of one device,
+ *          delta-of-delta timestamps and delta temperature codes in 
+ *          independently decodable blocks.
+ * 
+ * @attention   
+ *          Block header (little endian) holds first timestamp (4 bytes), first
+ *          value (4 bytes) and sample count (2 bytes + 2 reserved). Every next
+ *          sample is stored as a bit stream (MSB first) of timestamp 
+ *          delta-of-delta and value delta, both zig-zag encoded:
+ *              - '0'                   zero
+ *              - '10'   + short field  7 bits timestamp, 3 bits value
+ *              - '110'  + medium field 9 bits timestamp, 7 bits value
+ *              - '1110' + long field   12 bits timestamp and value
+ *              - '1111' + 32 bits
+ *          Periodic sample with unchanged temperature takes 2 bits, typical 
+ *          0.1 degree step 6 bits.
+ * 
+ * @verbatim
+ *          ********************************************************************
+ *                                How to use this module
+ *          ********************************************************************
+ *          1. Initialize compressor by DS1820_CompressInit with block buffer.
+ * 
+ *          2. Append samples by DS1820_CompressAppend until it fails, then
+ *          call DS1820_CompressFinish and start a new block.
+ *
+ *          3. Find block by DS1820_CompressBlockFind and decode it by 
+ *          DS1820_DecompressInit and DS1820_DecompressNext.
+ *  @endverbatim  
+ *******************************************************************************
+ */
+#include "DS1820_Compress.h"
+
+/* Longest sample in bits, two 4 bit prefixes with 32 bit fields */
+#define SAMPLE_MAX_BITS     72
+
+/* Field widths of prefix classes */
+static const uint8_t TimeWidth[] = {0, 7, 9, 12, 32};
+static const uint8_t ValueWidth[] = {0, 3, 7, 12, 32};
+
+/* Internal functions */
+static void FieldPut(DS1820_CompressWriter *Writer, uint32_t iValue, const uint8_t *Width);
+static uint32_t FieldGet(DS1820_CompressReader *Reader, const uint8_t *Width);
+static void BitsPut(DS1820_CompressWriter *Writer, uint32_t iValue, int iCount);
+static uint32_t BitsGet(DS1820_CompressReader *Reader, int iCount);
+static void Put32(uint8_t *pData, uint32_t iValue);
+static uint32_t Get32(const uint8_t *pData);
+
+/**
+ * Initializes compressor with empty block.
+ * @param Writer Compressor to be initialized.
+ * @param pBlock Block buffer.
+ * @param iSize Block buffer size, at least DS1820_COMPRESS_HEADER bytes.
+ */
+void DS1820_CompressInit(DS1820_CompressWriter *Writer, uint8_t *pBlock, uint32_t iSize) {
+    Writer->pBlock = pBlock;
+    Writer->iSize = iSize;
+    Writer->iLength = DS1820_COMPRESS_HEADER;
+    Writer->iBits = 0;
+    Writer->iFill = 0;
+    Writer->iCount = 0;
+}
+
+/**
+ * Appends sample into block.
+ * @param Writer Compressor.
+ * @param iTime Sample timestamp, non-decreasing.
+ * @param iValue Sample value, e.g. temperature in degrees of Celsius * 10.
+ * @return DS1820_OK if successfull, DS1820_ERROR if block is full.
+ */
+DS1820_State DS1820_CompressAppend(DS1820_CompressWriter *Writer, uint32_t iTime, int iValue) {
+    int32_t iDelta, iDod, iChange;
+
+    if (Writer->iCount == 0) {
+        if (Writer->iSize < DS1820_COMPRESS_HEADER) return DS1820_ERROR;
+
+        /* First sample is stored in the header */
+        Put32(&Writer->pBlock[0], iTime);
+        Put32(&Writer->pBlock[4], (uint32_t) iValue);
+        Writer->iTime = iTime;
+        Writer->iDelta = 0;
+        Writer->iValue = iValue;
+        Writer->iCount = 1;
+        return DS1820_OK;
+    }
+
+    if ((Writer->iCount == 0xFFFF) ||
+            (8 * Writer->iLength + Writer->iFill + SAMPLE_MAX_BITS > 8 * Writer->iSize))
+        return DS1820_ERROR;
+
+    iDelta = (int32_t) (iTime - Writer->iTime);
+    iDod = (int32_t) ((uint32_t) iDelta - (uint32_t) Writer->iDelta);
+    iChange = (int32_t) ((uint32_t) iValue - (uint32_t) Writer->iValue);
+
+    FieldPut(Writer, ((uint32_t) iDod << 1) ^ (uint32_t) (iDod >> 31), TimeWidth);
+    FieldPut(Writer, ((uint32_t) iChange << 1) ^ (uint32_t) (iChange >> 31), ValueWidth);
+
+    Writer->iTime = iTime;
+    Writer->iDelta = iDelta;
+    Writer->iValue = iValue;
+    Writer->iCount++;
+
+    return DS1820_OK;
+}
+
+/**
+ * Completes block.
+ * @param Writer Compressor.
+ * @return Block length in bytes.
+ */
+uint32_t DS1820_CompressFinish(DS1820_CompressWriter *Writer) {
+    /* Pad last byte by zeros */
+    if (Writer->iFill & 7) BitsPut(Writer, 0, 8 - (Writer->iFill & 7));
+
+    Put32(&Writer->pBlock[8], Writer->iCount);
+
+    return Writer->iLength;
+}
+
+/**
+ * Initializes decompressor of one block.
+ * @param Reader Decompressor to be initialized.
+ * @param pBlock Block data.
+ * @param iLength Block length in bytes.
+ * @return DS1820_OK if successfull, DS1820_ERROR if block is too short.
+ */
+DS1820_State DS1820_DecompressInit(DS1820_CompressReader *Reader, const uint8_t *pBlock, uint32_t iLength) {
+    if (iLength < DS1820_COMPRESS_HEADER) return DS1820_ERROR;
+
+    Reader->pBlock = pBlock;
+    Reader->iLength = iLength;
+    Reader->iPosition = DS1820_COMPRESS_HEADER;
+    Reader->iBits = 0;
+    Reader->iFill = 0;
+    Reader->iCount = (uint16_t) Get32(&pBlock[8]);
+    Reader->iRead = 0;
+
+    return DS1820_OK;
+}
+
+/**
+ * Decodes next sample of block.
+ * @param Reader Decompressor.
+ * @param iTime Sample timestamp output.
+ * @param iValue Sample value output.
+ * @return 1 if sample was decoded, 0 at the end of block.
+ */
+int DS1820_DecompressNext(DS1820_CompressReader *Reader, uint32_t *iTime, int *iValue) {
+    uint32_t iDod, iChange;
+
+    if (Reader->iRead >= Reader->iCount) return 0;
+
+    if (Reader->iRead == 0) {
+        Reader->iTime = Get32(&Reader->pBlock[0]);
+        Reader->iValue = (int32_t) Get32(&Reader->pBlock[4]);
+        Reader->iDelta = 0;
+    } else {
+        iDod = FieldGet(Reader, TimeWidth);
+        iChange = FieldGet(Reader, ValueWidth);
+
+        Reader->iDelta += (int32_t) ((iDod >> 1) ^ -(iDod & 1));
+        Reader->iTime += (uint32_t) Reader->iDelta;
+        Reader->iValue += (int32_t) ((iChange >> 1) ^ -(iChange & 1));
+    }
+
+    Reader->iRead++;
+
+    (*iTime) = Reader->iTime;
+    (*iValue) = Reader->iValue;
+
+    return 1;
+}
+
+/**
+ * Returns first timestamp of block.
+ * @param pBlock Block data.
+ * @return Timestamp of the first sample.
+ */
+uint32_t DS1820_CompressBlockTime(const uint8_t *pBlock) {
+    return Get32(pBlock);
+}
+
+/**
+ * Finds block containing timestamp by binary search over block headers.
+ * @param Blocks Array of blocks in time order.
+ * @param iCount Number of blocks.
+ * @param iTime Searched timestamp.
+ * @return Index of the last block starting at or before iTime, 0 if iTime
+ * precedes all blocks, -1 if there are no blocks.
+ */
+int DS1820_CompressBlockFind(const uint8_t * const *Blocks, int iCount, uint32_t iTime) {
+    int iLow = 0, iHigh = iCount - 1, iMiddle;
+
+    if (iCount <= 0) return -1;
+
+    while (iLow < iHigh) {
+        iMiddle = (iLow + iHigh + 1) / 2;
+
+        if (Get32(Blocks[iMiddle]) <= iTime) iLow = iMiddle;
+        else iHigh = iMiddle - 1;
+    }
+
+    return iLow;
+}
+
+/**
+ * Stores zig-zag value with the shortest fitting prefix.
+ */
+void FieldPut(DS1820_CompressWriter *Writer, uint32_t iValue, const uint8_t *Width) {
+    if (iValue == 0) {
+        BitsPut(Writer, 0x0, 1);
+    } else if (iValue < (1UL << Width[1])) {
+        BitsPut(Writer, (0x2UL << Width[1]) | iValue, 2 + Width[1]);
+    } else if (iValue < (1UL << Width[2])) {
+        BitsPut(Writer, (0x6UL << Width[2]) | iValue, 3 + Width[2]);
+    } else if (iValue < (1UL << Width[3])) {
+        BitsPut(Writer, (0xEUL << Width[3]) | iValue, 4 + Width[3]);
+    } else {
+        BitsPut(Writer, 0xF, 4);
+        BitsPut(Writer, iValue, 32);
+    }
+}
+
+/**
+ * Loads zig-zag value stored by FieldPut.
+ */
+uint32_t FieldGet(DS1820_CompressReader *Reader, const uint8_t *Width) {
+    int iClass = 0;
+
+    /* Count leading ones of prefix */
+    while ((iClass < 4) && BitsGet(Reader, 1)) iClass++;
+
+    return (iClass) ? BitsGet(Reader, Width[iClass]) : 0;
+}
+
+/**
+ * Appends up to 32 bits into bit stream.
+ */
+void BitsPut(DS1820_CompressWriter *Writer, uint32_t iValue, int iCount) {
+    Writer->iBits = (Writer->iBits << iCount) | (iValue & (0xFFFFFFFFUL >> (32 - iCount)));
+    Writer->iFill += iCount;
+
+    while (Writer->iFill >= 8) {
+        Writer->iFill -= 8;
+        Writer->pBlock[Writer->iLength++] = (uint8_t) (Writer->iBits >> Writer->iFill);
+    }
+}
+
+/**
+ * Loads up to 32 bits from bit stream, zeros are read behind the block end.
+ */
+uint32_t BitsGet(DS1820_CompressReader *Reader, int iCount) {
+    while (Reader->iFill < iCount) {
+        Reader->iBits <<= 8;
+        if (Reader->iPosition < Reader->iLength)
+            Reader->iBits |= Reader->pBlock[Reader->iPosition++];
+        Reader->iFill += 8;
+    }
+
+    Reader->iFill -= iCount;
+
+    return (uint32_t) (Reader->iBits >> Reader->iFill) & (0xFFFFFFFFUL >> (32 - iCount));
+}
+
+/**
+ * Stores 32bit little endian value.
+ */
+void Put32(uint8_t *pData, uint32_t iValue) {
+    pData[0] = (uint8_t) iValue;
+    pData[1] = (uint8_t) (iValue >> 8);
+    pData[2] = (uint8_t) (iValue >> 16);
+    pData[3] = (uint8_t) (iValue >> 24);
+}
+
+/**
+ * Loads 32bit little endian value.
+ */
+uint32_t Get32(const uint8_t *pData) {
+    return (uint32_t) pData[0] | ((uint32_t) pData[1] << 8) |
+            ((uint32_t) pData[2] << 16) | ((uint32_t) pData[3] << 24);
+}
@@ -0,0 +1,71 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Compress.h
+ * @author  Vojtech Vigner
+ * @brief   Bit packed compression of temperature time series of one device,
+ *          delta-of-delta timestamps and delta temperature codes in 
+ *          independently decodable blocks.
+ *          
+ * @see     DS1820_Compress.c documentation
+ *******************************************************************************
+ */
+
+#ifndef DS1820_COMPRESS_H
+#define	DS1820_COMPRESS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "DS1820.h"
+
+    /* Block header length in bytes */
+#define DS1820_COMPRESS_HEADER  12
+
+    /* Compressor state */
+    typedef struct _DS1820_CompressWriter {
+        uint8_t *pBlock;
+        uint32_t iSize;
+        uint32_t iLength;
+        uint64_t iBits;
+        int iFill;
+        uint16_t iCount;
+        uint32_t iTime;
+        int32_t iDelta;
+        int32_t iValue;
+    } DS1820_CompressWriter;
+
+    /* Decompressor state */
+    typedef struct _DS1820_CompressReader {
+        const uint8_t *pBlock;
+        uint32_t iLength;
+        uint32_t iPosition;
+        uint64_t iBits;
+        int iFill;
+        uint16_t iCount;
+        uint16_t iRead;
+        uint32_t iTime;
+        int32_t iDelta;
+        int32_t iValue;
+    } DS1820_CompressReader;
+
+    /* Compression */
+    void DS1820_CompressInit(DS1820_CompressWriter *Writer, uint8_t *pBlock, uint32_t iSize);
+    DS1820_State DS1820_CompressAppend(DS1820_CompressWriter *Writer, uint32_t iTime, int iValue);
+    uint32_t DS1820_CompressFinish(DS1820_CompressWriter *Writer);
+
+    /* Decompression */
+    DS1820_State DS1820_DecompressInit(DS1820_CompressReader *Reader, const uint8_t *pBlock, uint32_t iLength);
+    int DS1820_DecompressNext(DS1820_CompressReader *Reader, uint32_t *iTime, int *iValue);
+
+    /* Random access */
+    uint32_t DS1820_CompressBlockTime(const uint8_t *pBlock);
+    int DS1820_CompressBlockFind(const uint8_t * const *Blocks, int iCount, uint32_t iTime);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DS1820_COMPRESS_H */
+
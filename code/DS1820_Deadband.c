@@ -0,0 +1,151 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Deadband.c
+ * @author  Vojtech Vigner
+ * @brief   Change-only reporting stage, passes sample of device only if it 
+ *          differs enough from the last reported one or if the device was 
+ *          silent for too long.
+ * 
+ * @attention   
+ *          Sample is reported if its absolute difference from the last 
+ *          reported value is at least the threshold (1 reports any change, 
+ *          0 reports everything) or if the heartbeat period elapsed since the
+ *          last report (0 disables heartbeat). The first sample of device is 
+ *          always reported.
+ * 
+ * @verbatim
+ *          ********************************************************************
+ *                                How to use this module
+ *          ********************************************************************
+ *          1. Set default threshold, heartbeat and event consumer by 
+ *          DS1820_DeadbandInit, optionally change them per device by 
+ *          DS1820_DeadbandConfigure.
+ * 
+ *          2. Register DS1820_DeadbandSink by DS1820_SampleSinkAdd.
+ *
+ *          3. Call DS1820_DeadbandFlush after DS1820_TemperatureReadAll to 
+ *          deliver the rest of the batch.
+ *  @endverbatim  
+ *******************************************************************************
+ */
+#include "DS1820_Deadband.h"
+
+/* Device filter state */
+#define FILTER_REPORTED     0x01
+
+typedef struct _DS1820_Filter {
+    uint32_t iTime;
+    uint32_t iHeartbeat;
+    int16_t iTemp;
+    int16_t iThreshold;
+    uint8_t iFlags;
+} DS1820_Filter;
+
+static DS1820_Filter Filters[DS1820_MAX_DEVICES];
+
+/* Pending batch */
+static DS1820_Event Events[DS1820_DEADBAND_BATCH];
+static int iEventCount = 0;
+static DS1820_EventSink EventSink = 0;
+static uint32_t iSuppressed = 0;
+
+/**
+ * Sets threshold and heartbeat of all devices and clears their state. Pending
+ * events are dropped.
+ * @param iThreshold Minimal reported change in degrees of Celsius * 10.
+ * @param iHeartbeat Maximal silence in tick units (see DS1820_TickSet).
+ * @param Sink Event consumer.
+ */
+void DS1820_DeadbandInit(int iThreshold, uint32_t iHeartbeat, DS1820_EventSink Sink) {
+    int i;
+
+    for (i = 0; i < DS1820_MAX_DEVICES; i++) {
+        Filters[i].iThreshold = (int16_t) iThreshold;
+        Filters[i].iHeartbeat = iHeartbeat;
+        Filters[i].iFlags = 0;
+    }
+
+    iEventCount = 0;
+    iSuppressed = 0;
+    EventSink = Sink;
+}
+
+/**
+ * Sets threshold and heartbeat of one device.
+ * @param iDevice Device handle.
+ * @param iThreshold Minimal reported change in degrees of Celsius * 10.
+ * @param iHeartbeat Maximal silence in tick units.
+ * @return DS1820_OK if successfull, DS1820_ERROR if handle is invalid.
+ */
+DS1820_State DS1820_DeadbandConfigure(int iDevice, int iThreshold, uint32_t iHeartbeat) {
+    if ((iDevice < 0) || (iDevice >= DS1820_MAX_DEVICES)) return DS1820_ERROR;
+
+    Filters[iDevice].iThreshold = (int16_t) iThreshold;
+    Filters[iDevice].iHeartbeat = iHeartbeat;
+
+    return DS1820_OK;
+}
+
+/**
+ * Filters sample and appends it into batch if it is significant. Full batch
+ * is delivered to the consumer.
+ * @param iDevice Device handle.
+ * @param iTime Sample timestamp.
+ * @param iTemp Temperature in degrees of Celsius * 10.
+ * @return 1 if sample was reported, 0 if suppressed.
+ */
+int DS1820_DeadbandUpdate(int iDevice, uint32_t iTime, int iTemp) {
+    DS1820_Filter *Filter;
+    int iChange;
+
+    if ((iDevice < 0) || (iDevice >= DS1820_MAX_DEVICES)) return 0;
+
+    Filter = &Filters[iDevice];
+    iChange = iTemp - Filter->iTemp;
+    if (iChange < 0) iChange = -iChange;
+
+    if ((Filter->iFlags & FILTER_REPORTED) && (iChange < Filter->iThreshold) &&
+            ((Filter->iHeartbeat == 0) || (iTime - Filter->iTime < Filter->iHeartbeat))) {
+        iSuppressed++;
+        return 0;
+    }
+
+    Filter->iTemp = (int16_t) iTemp;
+    Filter->iTime = iTime;
+    Filter->iFlags |= FILTER_REPORTED;
+
+    Events[iEventCount].iDevice = iDevice;
+    Events[iEventCount].iTime = iTime;
+    Events[iEventCount].iTemp = iTemp;
+
+    if (++iEventCount == DS1820_DEADBAND_BATCH) DS1820_DeadbandFlush();
+
+    return 1;
+}
+
+/**
+ * Read engine consumer, see DS1820_SampleSinkAdd.
+ * @param iDevice Device handle.
+ * @param iTime Sample timestamp.
+ * @param iTemp Temperature in degrees of Celsius * 10.
+ */
+void DS1820_DeadbandSink(int iDevice, uint32_t iTime, int iTemp) {
+    DS1820_DeadbandUpdate(iDevice, iTime, iTemp);
+}
+
+/**
+ * Delivers pending events to the consumer.
+ */
+void DS1820_DeadbandFlush(void) {
+    if ((iEventCount) && (EventSink)) EventSink(Events, iEventCount);
+
+    iEventCount = 0;
+}
+
+/**
+ * Returns number of suppressed samples since DS1820_DeadbandInit.
+ * @return Number of suppressed samples.
+ */
+uint32_t DS1820_DeadbandSuppressed(void) {
+    return iSuppressed;
+}
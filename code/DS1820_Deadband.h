@@ -0,0 +1,55 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Deadband.h
+ * @author  Vojtech Vigner
+ * @brief   Change-only reporting stage, passes sample of device only if it 
+ *          differs enough from the last reported one or if the device was 
+ *          silent for too long.
+ *          
+ * @see     DS1820_Deadband.c documentation
+ *******************************************************************************
+ */
+
+#ifndef DS1820_DEADBAND_H
+#define	DS1820_DEADBAND_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "DS1820.h"
+
+    /* Number of events delivered at once */
+#ifndef DS1820_DEADBAND_BATCH
+#define DS1820_DEADBAND_BATCH   16
+#endif
+
+    /* Reported change */
+    typedef struct _DS1820_Event {
+        int iDevice;
+        uint32_t iTime;
+        int32_t iTemp;
+    } DS1820_Event;
+
+    /* Event consumer, receives batches of reported changes */
+    typedef void (*DS1820_EventSink)(const DS1820_Event *Events, int iCount);
+
+    /* Configuration */
+    void DS1820_DeadbandInit(int iThreshold, uint32_t iHeartbeat, DS1820_EventSink Sink);
+    DS1820_State DS1820_DeadbandConfigure(int iDevice, int iThreshold, uint32_t iHeartbeat);
+
+    /* Filtering */
+    int DS1820_DeadbandUpdate(int iDevice, uint32_t iTime, int iTemp);
+    void DS1820_DeadbandSink(int iDevice, uint32_t iTime, int iTemp);
+    void DS1820_DeadbandFlush(void);
+
+    /* Statistics */
+    uint32_t DS1820_DeadbandSuppressed(void);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DS1820_DEADBAND_H */
+
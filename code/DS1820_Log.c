@@ -0,0 +1,495 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Log.c
+ * @author  Vojtech Vigner
+ * @brief   Compact binary sample log, streaming writer with bounded memory and
+ *          memory mapped reader with time range selection and optional block
+ *          index for seeking.
+ * 
+ * @attention   
+ *          Log is a sequence of independent blocks. Every block starts with
+ *          header (little endian):
+ *              - magic (4 bytes), block length (4 bytes)
+ *              - first and last timestamp (4 + 4 bytes)
+ *              - device count and sample count (2 + 2 bytes)
+ *              - device addresses (8 bytes each)
+ *          followed by samples, each of three varints: device index in the 
+ *          block, zig-zag delta-of-delta of timestamp and zig-zag delta of 
+ *          temperature from the previous sample of the same device. Periodic
+ *          sample usually takes 3 bytes. Timestamp unit is up to the user, 
+ *          it has to be non-decreasing.
+ *          Blocks have variable length, so without index the reader walks
+ *          block headers from the start of the log to the selected range, 
+ *          skipping blocks without decoding them. Block index built by 
+ *          DS1820_LogIndexBuild holds block offsets, ranges are then found by
+ *          binary search over block timestamps.
+ * 
+ * @verbatim
+ *          ********************************************************************
+ *                                How to use this module
+ *          ********************************************************************
+ *          1. Initialize writer by DS1820_LogWriterInit with output function
+ *          (e.g. file or flash writer).
+ * 
+ *          2. Append samples by DS1820_LogAppend, full blocks are written 
+ *          automatically, DS1820_LogFlush writes incomplete block.
+ *
+ *          3. On the host open log by DS1820_LogReaderOpen (memory mapped) or
+ *          DS1820_LogReaderInit (memory buffer), optionally build block index
+ *          by DS1820_LogIndexBuild, select time range by DS1820_LogRange and
+ *          iterate samples by DS1820_LogNext.
+ *  @endverbatim  
+ *******************************************************************************
+ */
+#if defined(__unix__) || defined(__APPLE__)
+#define LOG_MMAP
+#define _POSIX_C_SOURCE 200112L
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+#include "DS1820_Log.h"
+
+#if (DS1820_LOG_INDEX_SIZE & (DS1820_LOG_INDEX_SIZE - 1)) || (DS1820_LOG_INDEX_SIZE < 2 * DS1820_LOG_MAX_DEVICES)
+#error "DS1820_LOG_INDEX_SIZE has to be power of two at least twice DS1820_LOG_MAX_DEVICES"
+#endif
+
+/* Block header length in bytes */
+#define HEADER_LENGTH       20
+
+/* Longest encoded sample, three 5 byte varints */
+#define SAMPLE_MAX_LENGTH   15
+
+/* Internal functions */
+static int DeviceIndex(DS1820_LogWriter *Writer, uint64_t iAddress);
+static uint8_t *VarintPut(uint8_t *pData, uint32_t iValue);
+static const uint8_t *VarintGet(const uint8_t *pData, const uint8_t *pEnd, uint32_t *iValue);
+static void Put32(uint8_t *pData, uint32_t iValue);
+static uint32_t Get32(const uint8_t *pData);
+static uint64_t Get64(const uint8_t *pData);
+static int BlockOpen(DS1820_LogReader *Reader);
+static uint8_t BlockValid(const DS1820_LogReader *Reader, size_t iOffset);
+static size_t BlockSeek(const DS1820_LogReader *Reader, uint32_t iFrom);
+
+/**
+ * Initializes log writer.
+ * @param Writer Writer to be initialized.
+ * @param Output Block output function.
+ * @param pContext User pointer passed to output function.
+ */
+void DS1820_LogWriterInit(DS1820_LogWriter *Writer, DS1820_LogOutput Output, void *pContext) {
+    memset(Writer, 0, sizeof (DS1820_LogWriter));
+    Writer->Output = Output;
+    Writer->pContext = pContext;
+}
+
+/**
+ * Appends sample into log. Block is written when it is full.
+ * @param Writer Log writer.
+ * @param iAddress 64bit device address.
+ * @param iTime Sample timestamp, non-decreasing.
+ * @param iTemp Temperature in degrees of Celsius * 10.
+ * @return DS1820_OK if successfull, DS1820_ERROR if block output failed.
+ */
+DS1820_State DS1820_LogAppend(DS1820_LogWriter *Writer, uint64_t iAddress, uint32_t iTime, int iTemp) {
+    int iDevice;
+    int32_t iDelta, iValue;
+    uint8_t *pData;
+
+    /* Write full block */
+    if ((Writer->iLength + SAMPLE_MAX_LENGTH > DS1820_LOG_BLOCK_SIZE) || (Writer->iSamples == 0xFFFF))
+        if (DS1820_LogFlush(Writer)) return DS1820_ERROR;
+
+    /* Write block with full device list */
+    iDevice = DeviceIndex(Writer, iAddress);
+    if (iDevice < 0) {
+        if (DS1820_LogFlush(Writer)) return DS1820_ERROR;
+        iDevice = DeviceIndex(Writer, iAddress);
+    }
+
+    if (Writer->iSamples == 0) {
+        Writer->iFirstTime = iTime;
+        Writer->iLastTime = iTime;
+        Writer->iLastDelta = 0;
+    }
+
+    pData = &Writer->Payload[Writer->iLength];
+    pData = VarintPut(pData, (uint32_t) iDevice);
+
+    /* Zig-zag delta-of-delta of timestamp */
+    iDelta = (int32_t) (iTime - Writer->iLastTime);
+    iValue = (int32_t) ((uint32_t) iDelta - (uint32_t) Writer->iLastDelta);
+    pData = VarintPut(pData, ((uint32_t) iValue << 1) ^ (uint32_t) (iValue >> 31));
+
+    /* Zig-zag delta of temperature */
+    iValue = (int32_t) ((uint32_t) iTemp - (uint32_t) Writer->Last[iDevice]);
+    pData = VarintPut(pData, ((uint32_t) iValue << 1) ^ (uint32_t) (iValue >> 31));
+
+    Writer->iLength = (uint32_t) (pData - Writer->Payload);
+    Writer->iLastTime = iTime;
+    Writer->iLastDelta = iDelta;
+    Writer->Last[iDevice] = iTemp;
+    Writer->iSamples++;
+
+    return DS1820_OK;
+}
+
+/**
+ * Writes incomplete block, e.g. before shutdown.
+ * @param Writer Log writer.
+ * @return DS1820_OK if successfull, DS1820_ERROR if block output failed.
+ */
+DS1820_State DS1820_LogFlush(DS1820_LogWriter *Writer) {
+    uint8_t Header[HEADER_LENGTH];
+    uint8_t Address[8];
+    int i, j;
+    DS1820_State iResult = DS1820_OK;
+
+    if (Writer->iSamples == 0) return DS1820_OK;
+
+    Put32(&Header[0], DS1820_LOG_MAGIC);
+    Put32(&Header[4], HEADER_LENGTH + 8 * Writer->iDevices + Writer->iLength);
+    Put32(&Header[8], Writer->iFirstTime);
+    Put32(&Header[12], Writer->iLastTime);
+    Put32(&Header[16], Writer->iDevices | ((uint32_t) Writer->iSamples << 16));
+
+    if (Writer->Output(Writer->pContext, Header, HEADER_LENGTH)) iResult = DS1820_ERROR;
+
+    for (i = 0; (i < Writer->iDevices) && (iResult == DS1820_OK); i++) {
+        for (j = 0; j < 8; j++) Address[j] = (uint8_t) (Writer->Devices[i] >> (8 * j));
+        if (Writer->Output(Writer->pContext, Address, 8)) iResult = DS1820_ERROR;
+    }
+
+    if ((iResult == DS1820_OK) && Writer->Output(Writer->pContext, Writer->Payload, Writer->iLength))
+        iResult = DS1820_ERROR;
+
+    /* Start new block, samples are dropped if output failed */
+    memset(Writer->Index, 0, sizeof (Writer->Index));
+    memset(Writer->Last, 0, sizeof (Writer->Last));
+    Writer->iDevices = 0;
+    Writer->iSamples = 0;
+    Writer->iLength = 0;
+
+    return iResult;
+}
+
+/**
+ * Initializes reader of log in memory.
+ * @param Reader Reader to be initialized.
+ * @param pData Log data.
+ * @param iSize Log data length in bytes.
+ */
+void DS1820_LogReaderInit(DS1820_LogReader *Reader, const void *pData, size_t iSize) {
+    memset(Reader, 0, sizeof (DS1820_LogReader));
+    Reader->pData = (const uint8_t *) pData;
+    Reader->iSize = iSize;
+    Reader->iTo = 0xFFFFFFFF;
+}
+
+/**
+ * Opens log file by mapping it into memory, available on POSIX systems only.
+ * @param Reader Reader to be initialized.
+ * @param sPath Log file path.
+ * @return DS1820_OK if successfull, DS1820_ERROR if failed.
+ */
+DS1820_State DS1820_LogReaderOpen(DS1820_LogReader *Reader, const char *sPath) {
+#ifdef LOG_MMAP
+    struct stat Stat;
+    void *pMap;
+    int iFile = open(sPath, O_RDONLY);
+
+    if (iFile < 0) return DS1820_ERROR;
+
+    if (fstat(iFile, &Stat) < 0) {
+        close(iFile);
+        return DS1820_ERROR;
+    }
+
+    /* Empty log can not be mapped */
+    if (Stat.st_size == 0) {
+        close(iFile);
+        DS1820_LogReaderInit(Reader, 0, 0);
+        return DS1820_OK;
+    }
+
+    pMap = mmap(0, (size_t) Stat.st_size, PROT_READ, MAP_PRIVATE, iFile, 0);
+    close(iFile);
+
+    if (pMap == MAP_FAILED) return DS1820_ERROR;
+
+    DS1820_LogReaderInit(Reader, pMap, (size_t) Stat.st_size);
+    Reader->pMap = pMap;
+
+    return DS1820_OK;
+#else
+    (void) Reader;
+    (void) sPath;
+    return DS1820_ERROR;
+#endif
+}
+
+/**
+ * Closes log opened by DS1820_LogReaderOpen.
+ * @param Reader Log reader.
+ */
+void DS1820_LogReaderClose(DS1820_LogReader *Reader) {
+#ifdef LOG_MMAP
+    if (Reader->pMap) munmap(Reader->pMap, Reader->iSize);
+#endif
+    DS1820_LogReaderInit(Reader, 0, 0);
+}
+
+/**
+ * Builds block index, offsets of all blocks in the log. Index is used by 
+ * DS1820_LogRange until the reader is closed or initialized again.
+ * @param Reader Log reader.
+ * @param Offsets Array for iMax block offsets, kept by the reader.
+ * @param iMax Index capacity, blocks behind a full index are found by walking
+ * their headers.
+ * @return Number of indexed blocks.
+ */
+size_t DS1820_LogIndexBuild(DS1820_LogReader *Reader, size_t *Offsets, size_t iMax) {
+    size_t iOffset = 0, iBlocks = 0;
+
+    while ((iBlocks < iMax) && BlockValid(Reader, iOffset)) {
+        Offsets[iBlocks++] = iOffset;
+        iOffset += Get32(Reader->pData + iOffset + 4);
+    }
+
+    Reader->pIndex = Offsets;
+    Reader->iBlocks = iBlocks;
+
+    return iBlocks;
+}
+
+/**
+ * Selects time range and rewinds reader to the first block which may hold
+ * it. Blocks outside the range are skipped by their headers without 
+ * decoding, with block index the first block is found by binary search.
+ * @param Reader Log reader.
+ * @param iFrom First timestamp, inclusive.
+ * @param iTo Last timestamp, inclusive.
+ */
+void DS1820_LogRange(DS1820_LogReader *Reader, uint32_t iFrom, uint32_t iTo) {
+    Reader->iFrom = iFrom;
+    Reader->iTo = iTo;
+    Reader->iNext = BlockSeek(Reader, iFrom);
+    Reader->iSamples = 0;
+}
+
+/**
+ * Reads next sample in selected time range.
+ * @param Reader Log reader.
+ * @param iAddress 64bit device address output.
+ * @param iTime Sample timestamp output.
+ * @param iTemp Temperature output.
+ * @return 1 if sample was read, 0 at the end of log or range.
+ */
+int DS1820_LogNext(DS1820_LogReader *Reader, uint64_t *iAddress, uint32_t *iTime, int *iTemp) {
+    const uint8_t *pData;
+    uint32_t iDevice, iDod, iDelta;
+
+    while (1) {
+        while (Reader->iSamples == 0)
+            if (!BlockOpen(Reader)) return 0;
+
+        Reader->iSamples--;
+
+        pData = VarintGet(Reader->pPosition, Reader->pEnd, &iDevice);
+        pData = VarintGet(pData, Reader->pEnd, &iDod);
+        pData = VarintGet(pData, Reader->pEnd, &iDelta);
+
+        /* Skip rest of corrupted block */
+        if ((pData == 0) || (iDevice >= Reader->iDevices)) {
+            Reader->iSamples = 0;
+            continue;
+        }
+
+        Reader->pPosition = pData;
+        Reader->iDelta += (int32_t) ((iDod >> 1) ^ -(iDod & 1));
+        Reader->iTime += (uint32_t) Reader->iDelta;
+        Reader->Last[iDevice] += (int32_t) ((iDelta >> 1) ^ -(iDelta & 1));
+
+        if (Reader->iTime < Reader->iFrom) continue;
+
+        /* Timestamps are non-decreasing, range is over */
+        if (Reader->iTime > Reader->iTo) {
+            Reader->iSamples = 0;
+            Reader->iNext = Reader->iSize;
+            return 0;
+        }
+
+        (*iAddress) = Get64(Reader->pDevices + 8 * iDevice);
+        (*iTime) = Reader->iTime;
+        (*iTemp) = Reader->Last[iDevice];
+
+        return 1;
+    }
+}
+
+/**
+ * Finds device in block device list, adds it if there is a space left.
+ * @param Writer Log writer.
+ * @param iAddress 64bit device address.
+ * @return Device index in the block or -1 if device list is full.
+ */
+int DeviceIndex(DS1820_LogWriter *Writer, uint64_t iAddress) {
+    uint32_t iSlot = DS1820_ADDRESS_HASH(iAddress) & (DS1820_LOG_INDEX_SIZE - 1);
+
+    while (Writer->Index[iSlot]) {
+        if (Writer->Devices[Writer->Index[iSlot] - 1] == iAddress) return Writer->Index[iSlot] - 1;
+        iSlot = (iSlot + 1) & (DS1820_LOG_INDEX_SIZE - 1);
+    }
+
+    if (Writer->iDevices >= DS1820_LOG_MAX_DEVICES) return -1;
+
+    Writer->Devices[Writer->iDevices] = iAddress;
+    Writer->Index[iSlot] = ++Writer->iDevices;
+
+    return Writer->iDevices - 1;
+}
+
+/**
+ * Opens next block which overlaps selected time range.
+ * @param Reader Log reader.
+ * @return 1 if block was opened, 0 at the end of log or range.
+ */
+int BlockOpen(DS1820_LogReader *Reader) {
+    const uint8_t *pBlock;
+    uint32_t iLength, iCounts;
+
+    /* Stop at corrupted or truncated block */
+    while (BlockValid(Reader, Reader->iNext)) {
+        pBlock = Reader->pData + Reader->iNext;
+        iLength = Get32(&pBlock[4]);
+        Reader->iNext += iLength;
+
+        if (Get32(&pBlock[12]) < Reader->iFrom) continue;
+        if (Get32(&pBlock[8]) > Reader->iTo) break;
+
+        iCounts = Get32(&pBlock[16]);
+        Reader->iDevices = (uint16_t) iCounts;
+        Reader->iSamples = (uint16_t) (iCounts >> 16);
+
+        if ((Reader->iDevices > DS1820_LOG_MAX_DEVICES) ||
+                (HEADER_LENGTH + 8 * (uint32_t) Reader->iDevices > iLength)) {
+            Reader->iSamples = 0;
+            continue;
+        }
+
+        Reader->pDevices = pBlock + HEADER_LENGTH;
+        Reader->pPosition = Reader->pDevices + 8 * Reader->iDevices;
+        Reader->pEnd = pBlock + iLength;
+        Reader->iTime = Get32(&pBlock[8]);
+        Reader->iDelta = 0;
+        memset(Reader->Last, 0, sizeof (Reader->Last));
+
+        if (Reader->iSamples) return 1;
+    }
+
+    Reader->iNext = Reader->iSize;
+    return 0;
+}
+
+/**
+ * Checks that complete block with valid header starts at offset.
+ * @param Reader Log reader.
+ * @param iOffset Block offset.
+ * @return 1 if block is valid, 0 if not.
+ */
+uint8_t BlockValid(const DS1820_LogReader *Reader, size_t iOffset) {
+    const uint8_t *pBlock = Reader->pData + iOffset;
+    uint32_t iLength;
+
+    if ((iOffset > Reader->iSize) || (Reader->iSize - iOffset < HEADER_LENGTH)) return 0;
+
+    iLength = Get32(&pBlock[4]);
+
+    return (Get32(&pBlock[0]) == DS1820_LOG_MAGIC) && (iLength >= HEADER_LENGTH) &&
+            (iLength <= Reader->iSize - iOffset);
+}
+
+/**
+ * Finds offset of the first indexed block which ends at or after timestamp,
+ * block timestamps are non-decreasing.
+ * @param Reader Log reader.
+ * @param iFrom Timestamp.
+ * @return Block offset, 0 without index, the last indexed block if all 
+ * indexed blocks end before timestamp.
+ */
+size_t BlockSeek(const DS1820_LogReader *Reader, uint32_t iFrom) {
+    size_t iLow = 0, iHigh, iMiddle;
+
+    if ((Reader->pIndex == 0) || (Reader->iBlocks == 0)) return 0;
+
+    iHigh = Reader->iBlocks - 1;
+
+    while (iLow < iHigh) {
+        iMiddle = (iLow + iHigh) / 2;
+
+        if (Get32(Reader->pData + Reader->pIndex[iMiddle] + 12) < iFrom) iLow = iMiddle + 1;
+        else iHigh = iMiddle;
+    }
+
+    return Reader->pIndex[iLow];
+}
+
+/**
+ * Stores unsigned LEB128 varint.
+ * @return Pointer behind stored value.
+ */
+uint8_t *VarintPut(uint8_t *pData, uint32_t iValue) {
+    while (iValue >= 0x80) {
+        *pData++ = (uint8_t) (iValue | 0x80);
+        iValue >>= 7;
+    }
+    *pData++ = (uint8_t) iValue;
+
+    return pData;
+}
+
+/**
+ * Loads unsigned LEB128 varint.
+ * @return Pointer behind loaded value or NULL if data are corrupted.
+ */
+const uint8_t *VarintGet(const uint8_t *pData, const uint8_t *pEnd, uint32_t *iValue) {
+    int iShift = 0;
+
+    (*iValue) = 0;
+
+    while ((pData) && (pData < pEnd) && (iShift < 35)) {
+        (*iValue) |= (uint32_t) (*pData & 0x7F) << iShift;
+        if (!(*pData++ & 0x80)) return pData;
+        iShift += 7;
+    }
+
+    return 0;
+}
+
+/**
+ * Stores 32bit little endian value.
+ */
+void Put32(uint8_t *pData, uint32_t iValue) {
+    pData[0] = (uint8_t) iValue;
+    pData[1] = (uint8_t) (iValue >> 8);
+    pData[2] = (uint8_t) (iValue >> 16);
+    pData[3] = (uint8_t) (iValue >> 24);
+}
+
+/**
+ * Loads 32bit little endian value.
+ */
+uint32_t Get32(const uint8_t *pData) {
+    return (uint32_t) pData[0] | ((uint32_t) pData[1] << 8) |
+            ((uint32_t) pData[2] << 16) | ((uint32_t) pData[3] << 24);
+}
+
+/**
+ * Loads 64bit little endian value.
+ */
+uint64_t Get64(const uint8_t *pData) {
+    return (uint64_t) Get32(pData) | ((uint64_t) Get32(pData + 4) << 32);
+}
@@ -0,0 +1,105 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Log.h
+ * @author  Vojtech Vigner
+ * @brief   Compact binary sample log, streaming writer with bounded memory and
+ *          memory mapped reader with time range selection and optional block
+ *          index for seeking.
+ *          
+ * @see     DS1820_Log.c documentation
+ *******************************************************************************
+ */
+
+#ifndef DS1820_LOG_H
+#define	DS1820_LOG_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "DS1820.h"
+
+    /* Block payload size in bytes */
+#ifndef DS1820_LOG_BLOCK_SIZE
+#define DS1820_LOG_BLOCK_SIZE   1024
+#endif
+
+    /* Maximum number of devices in one block, independent of the device 
+     * table. Block of 1024 bytes holds up to about 340 samples, with more 
+     * sensors than devices per block the block is written early and every
+     * device costs 8 bytes of block header. Reader has to be built with at 
+     * least the writer value, blocks with more devices are skipped. Writer 
+     * takes about 20 bytes per device, small buses can use DS1820_MAX_DEVICES
+     */
+#ifndef DS1820_LOG_MAX_DEVICES
+#define DS1820_LOG_MAX_DEVICES  256
+#endif
+
+    /* Block device index size, power of two at least twice the devices */
+#ifndef DS1820_LOG_INDEX_SIZE
+#define DS1820_LOG_INDEX_SIZE   (2 * DS1820_LOG_MAX_DEVICES)
+#endif
+
+    /* Block identification */
+#define DS1820_LOG_MAGIC        0x314C5344
+
+    /* Block output function, returns zero if successfull */
+    typedef int (*DS1820_LogOutput)(void *pContext, const void *pData, uint32_t iLength);
+
+    /* Log writer state */
+    typedef struct _DS1820_LogWriter {
+        DS1820_LogOutput Output;
+        void *pContext;
+        uint64_t Devices[DS1820_LOG_MAX_DEVICES];
+        int32_t Last[DS1820_LOG_MAX_DEVICES];
+        uint16_t Index[DS1820_LOG_INDEX_SIZE];
+        uint16_t iDevices;
+        uint16_t iSamples;
+        uint32_t iFirstTime;
+        uint32_t iLastTime;
+        int32_t iLastDelta;
+        uint32_t iLength;
+        uint8_t Payload[DS1820_LOG_BLOCK_SIZE];
+    } DS1820_LogWriter;
+
+    /* Log reader state */
+    typedef struct _DS1820_LogReader {
+        const uint8_t *pData;
+        size_t iSize;
+        size_t iNext;
+        const uint8_t *pDevices;
+        const uint8_t *pPosition;
+        const uint8_t *pEnd;
+        int32_t Last[DS1820_LOG_MAX_DEVICES];
+        uint16_t iDevices;
+        uint16_t iSamples;
+        uint32_t iTime;
+        int32_t iDelta;
+        uint32_t iFrom;
+        uint32_t iTo;
+        const size_t *pIndex;
+        size_t iBlocks;
+        void *pMap;
+    } DS1820_LogReader;
+
+    /* Writer */
+    void DS1820_LogWriterInit(DS1820_LogWriter *Writer, DS1820_LogOutput Output, void *pContext);
+    DS1820_State DS1820_LogAppend(DS1820_LogWriter *Writer, uint64_t iAddress, uint32_t iTime, int iTemp);
+    DS1820_State DS1820_LogFlush(DS1820_LogWriter *Writer);
+
+    /* Reader */
+    void DS1820_LogReaderInit(DS1820_LogReader *Reader, const void *pData, size_t iSize);
+    DS1820_State DS1820_LogReaderOpen(DS1820_LogReader *Reader, const char *sPath);
+    void DS1820_LogReaderClose(DS1820_LogReader *Reader);
+    size_t DS1820_LogIndexBuild(DS1820_LogReader *Reader, size_t *Offsets, size_t iMax);
+    void DS1820_LogRange(DS1820_LogReader *Reader, uint32_t iFrom, uint32_t iTo);
+    int DS1820_LogNext(DS1820_LogReader *Reader, uint64_t *iAddress, uint32_t *iTime, int *iTemp);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DS1820_LOG_H */
+
@@ -0,0 +1,219 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Metrics.c
+ * @author  Vojtech Vigner
+ * @brief   Bus utilisation accounting and per API duration histograms with
+ *          Prometheus text format export. Compiled in only if 
+ *          DS1820_METRICS_ENABLE is defined.
+ * 
+ * @attention   
+ *          Bus time is modeled from the number of resets and time slots
+ *          issued by DS1820.c at the current bus speed, only strong pull-up
+ *          time is measured by DS1820_TickGet. Idle time is the rest of the
+ *          wall time since DS1820_MetricsInit. API duration is the modeled bus
+ *          time of one public call without the strong pull-up which outlasts 
+ *          it, nested calls are counted in the outer one.
+ * 
+ * @verbatim
+ *          ********************************************************************
+ *                                How to use this module
+ *          ********************************************************************
+ *          1. Define DS1820_METRICS_ENABLE for DS1820.c and this file.
+ * 
+ *          2. Register tick function by DS1820_TickSet and call 
+ *          DS1820_MetricsInit.
+ *
+ *          3. Serve DS1820_MetricsExport output on the metrics endpoint.
+ *  @endverbatim  
+ *******************************************************************************
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include "DS1820_Metrics.h"
+
+#ifdef DS1820_METRICS_ENABLE
+
+/* Per API duration histogram */
+typedef struct _DS1820_ApiMetric {
+    uint32_t Buckets[DS1820_METRICS_BUCKETS + 1];
+    uint32_t iCount;
+    uint64_t iSum;
+} DS1820_ApiMetric;
+
+static const char *ActivityNames[DS1820_BUS_ACTIVITIES] = {
+    "reset", "write", "read", "pullup"
+};
+
+static const char *ApiNames[DS1820_API_COUNT] = {
+    "convert", "get", "alarm_set", "alarm_get", "store", "recall", "power",
+    "search", "read"
+};
+
+static uint64_t BusTime[DS1820_BUS_ACTIVITIES];
+static DS1820_ApiMetric Apis[DS1820_API_COUNT];
+static uint32_t iStartTick;
+
+/* Currently measured API call */
+static int iDepth = 0;
+static DS1820_Api iCurrentApi;
+static uint64_t iApiStart;
+
+/* Internal functions */
+static uint64_t BusBusyTime(void);
+static int Append(char *Buffer, int iLength, int iPos, const char *Format, ...);
+
+/**
+ * Clears all metrics and starts wall time measurement.
+ */
+void DS1820_MetricsInit(void) {
+    int i, j;
+
+    for (i = 0; i < DS1820_BUS_ACTIVITIES; i++) BusTime[i] = 0;
+
+    for (i = 0; i < DS1820_API_COUNT; i++) {
+        for (j = 0; j <= DS1820_METRICS_BUCKETS; j++) Apis[i].Buckets[j] = 0;
+        Apis[i].iCount = 0;
+        Apis[i].iSum = 0;
+    }
+
+    iDepth = 0;
+    iStartTick = DS1820_TickGet();
+}
+
+/**
+ * Accounts bus time.
+ * @param iActivity Bus activity.
+ * @param iMicroSeconds Time in microseconds.
+ */
+void DS1820_MetricsBusAdd(DS1820_BusActivity iActivity, uint32_t iMicroSeconds) {
+    BusTime[iActivity] += iMicroSeconds;
+}
+
+/**
+ * Starts measurement of public API call, nested calls are ignored.
+ * @param iApi API group.
+ */
+void DS1820_MetricsApiBegin(DS1820_Api iApi) {
+    if (iDepth++) return;
+
+    iCurrentApi = iApi;
+    iApiStart = BusBusyTime();
+}
+
+/**
+ * Ends measurement of public API call and passes its result through.
+ * @param iResult Result of the call.
+ * @return iResult.
+ */
+int DS1820_MetricsApiEnd(int iResult) {
+    DS1820_ApiMetric *Api = &Apis[iCurrentApi];
+    uint64_t iDuration;
+    int iBucket = 0;
+
+    if ((iDepth == 0) || (--iDepth)) return iResult;
+
+    iDuration = BusBusyTime() - iApiStart;
+
+    while ((iBucket < DS1820_METRICS_BUCKETS) &&
+            (iDuration > ((uint64_t) DS1820_METRICS_BUCKET_BASE << iBucket)))
+        iBucket++;
+
+    Api->Buckets[iBucket]++;
+    Api->iCount++;
+    Api->iSum += iDuration;
+
+    return iResult;
+}
+
+/**
+ * Writes Prometheus text format snapshot of all metrics.
+ * @param Buffer Output buffer.
+ * @param iLength Output buffer length.
+ * @return Length of the text without terminating zero or -1 if the buffer is
+ * too small.
+ */
+int DS1820_MetricsExport(char *Buffer, int iLength) {
+    int i, j, iPos = 0;
+    uint64_t iWall, iBusy;
+    uint32_t iCumulative;
+
+    iWall = (uint64_t) (DS1820_TickGet() - iStartTick) * 1000;
+    iBusy = BusBusyTime();
+
+    iPos = Append(Buffer, iLength, iPos,
+            "# HELP ds1820_bus_seconds_total Bus time by activity, reset and slots are modeled.\n"
+            "# TYPE ds1820_bus_seconds_total counter\n");
+
+    for (i = 0; i < DS1820_BUS_ACTIVITIES; i++)
+        iPos = Append(Buffer, iLength, iPos, "ds1820_bus_seconds_total{bus=\"0\",activity=\"%s\"} %.6f\n",
+            ActivityNames[i], BusTime[i] / 1e6);
+
+    iPos = Append(Buffer, iLength, iPos, "ds1820_bus_seconds_total{bus=\"0\",activity=\"idle\"} %.6f\n",
+            (iWall > iBusy) ? (iWall - iBusy) / 1e6 : 0.0);
+
+    iPos = Append(Buffer, iLength, iPos,
+            "# HELP ds1820_bus_utilisation Busy share of wall time since metrics init.\n"
+            "# TYPE ds1820_bus_utilisation gauge\n"
+            "ds1820_bus_utilisation{bus=\"0\"} %.4f\n",
+            (iWall) ? (double) iBusy / iWall : 0.0);
+
+    iPos = Append(Buffer, iLength, iPos,
+            "# HELP ds1820_api_duration_seconds Modeled bus time of DS1820 API calls.\n"
+            "# TYPE ds1820_api_duration_seconds histogram\n");
+
+    for (i = 0; i < DS1820_API_COUNT; i++) {
+        for (j = 0, iCumulative = 0; j < DS1820_METRICS_BUCKETS; j++) {
+            iCumulative += Apis[i].Buckets[j];
+            iPos = Append(Buffer, iLength, iPos, "ds1820_api_duration_seconds_bucket{api=\"%s\",le=\"%g\"} %lu\n",
+                    ApiNames[i], ((uint32_t) DS1820_METRICS_BUCKET_BASE << j) / 1e6, (unsigned long) iCumulative);
+        }
+
+        iPos = Append(Buffer, iLength, iPos,
+                "ds1820_api_duration_seconds_bucket{api=\"%s\",le=\"+Inf\"} %lu\n"
+                "ds1820_api_duration_seconds_sum{api=\"%s\"} %.6f\n"
+                "ds1820_api_duration_seconds_count{api=\"%s\"} %lu\n",
+                ApiNames[i], (unsigned long) Apis[i].iCount,
+                ApiNames[i], Apis[i].iSum / 1e6,
+                ApiNames[i], (unsigned long) Apis[i].iCount);
+    }
+
+    return iPos;
+}
+
+/**
+ * Returns total modeled bus time.
+ * @return Time in microseconds.
+ */
+uint64_t BusBusyTime(void) {
+    uint64_t iBusy = 0;
+    int i;
+
+    for (i = 0; i < DS1820_BUS_ACTIVITIES; i++) iBusy += BusTime[i];
+
+    return iBusy;
+}
+
+/**
+ * Appends formatted text to the export buffer.
+ * @param Buffer Output buffer.
+ * @param iLength Output buffer length.
+ * @param iPos Current text length or -1 if the buffer has overflown.
+ * @param Format printf format.
+ * @return New text length or -1 if the buffer is too small.
+ */
+int Append(char *Buffer, int iLength, int iPos, const char *Format, ...) {
+    va_list Args;
+    int iWritten;
+
+    if (iPos < 0) return -1;
+
+    va_start(Args, Format);
+    iWritten = vsnprintf(Buffer + iPos, (size_t) (iLength - iPos), Format, Args);
+    va_end(Args);
+
+    if ((iWritten < 0) || (iWritten >= iLength - iPos)) return -1;
+
+    return iPos + iWritten;
+}
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Metrics.h
+ * @author  Vojtech Vigner
+ * @brief   Bus utilisation accounting and per API duration histograms with
+ *          Prometheus text format export. Compiled in only if 
+ *          DS1820_METRICS_ENABLE is defined.
+ *          
+ * @see     DS1820_Metrics.c documentation
+ *******************************************************************************
+ */
+
+#ifndef DS1820_METRICS_H
+#define	DS1820_METRICS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "DS1820.h"
+
+    /* Modeled standard speed timing in microseconds, reset with presence 
+     * detection and one read or write time slot including recovery */
+#ifndef DS1820_METRICS_RESET_TIME
+#define DS1820_METRICS_RESET_TIME       960
+#endif
+#ifndef DS1820_METRICS_SLOT_TIME
+#define DS1820_METRICS_SLOT_TIME        70
+#endif
+
+    /* Modeled overdrive speed timing in microseconds */
+#ifndef DS1820_METRICS_RESET_TIME_OD
+#define DS1820_METRICS_RESET_TIME_OD    100
+#endif
+#ifndef DS1820_METRICS_SLOT_TIME_OD
+#define DS1820_METRICS_SLOT_TIME_OD     10
+#endif
+
+    /* Number of API duration histogram buckets, bucket i upper bound is
+     * DS1820_METRICS_BUCKET_BASE * 2^i microseconds */
+#ifndef DS1820_METRICS_BUCKETS
+#define DS1820_METRICS_BUCKETS          12
+#endif
+#ifndef DS1820_METRICS_BUCKET_BASE
+#define DS1820_METRICS_BUCKET_BASE      250
+#endif
+
+    /* Bus activities */
+    typedef enum _DS1820_BusActivity {
+        DS1820_BUS_RESET = 0,
+        DS1820_BUS_WRITE,
+        DS1820_BUS_READ,
+        DS1820_BUS_PULLUP,
+        DS1820_BUS_ACTIVITIES
+    } DS1820_BusActivity;
+
+    /* Instrumented API groups */
+    typedef enum _DS1820_Api {
+        DS1820_API_CONVERT = 0,
+        DS1820_API_GET,
+        DS1820_API_ALARM_SET,
+        DS1820_API_ALARM_GET,
+        DS1820_API_STORE,
+        DS1820_API_RECALL,
+        DS1820_API_POWER,
+        DS1820_API_SEARCH,
+        DS1820_API_READ,
+        DS1820_API_COUNT
+    } DS1820_Api;
+
+    /* Setup */
+    void DS1820_MetricsInit(void);
+
+    /* Accounting, called by DS1820.c */
+    void DS1820_MetricsBusAdd(DS1820_BusActivity iActivity, uint32_t iMicroSeconds);
+    void DS1820_MetricsApiBegin(DS1820_Api iApi);
+    int DS1820_MetricsApiEnd(int iResult);
+
+    /* Export */
+    int DS1820_MetricsExport(char *Buffer, int iLength);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DS1820_METRICS_H */
+
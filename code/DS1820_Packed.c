@@ -0,0 +1,198 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Packed.c
+ * @author  Vojtech Vigner
+ * @brief   Compressed ROM address storage: 48bit serial number and family 
+ *          index, CRC is recalculated on demand.
+ * 
+ * @attention   
+ *          64bit ROM address consists of family code (LSB), 48bit serial 
+ *          number and CRC (MSB). Packed address takes 7 bytes instead of 8 and
+ *          packed table has no per entry overhead, so table of 10000 devices
+ *          takes 70 kB instead of 80 kB. Table is kept sorted, lookup is a
+ *          binary search and insertion moves entries behind the new one.
+ *          Memory is paid for by lookup time: searched address is packed and
+ *          its CRC checked and entries are compared bytewise, on a 64bit host
+ *          a lookup takes about twice as long as in a plain uint64_t table
+ *          (tools/DS1820_PackedBench.c). Device index is a position in the
+ *          sorted table, not a stable handle: every DS1820_PackedTableAdd of
+ *          a new address shifts indexes of all devices behind it, look
+ *          indexes up again after adding.
+ *******************************************************************************
+ */
+#include <string.h>
+#include "DS1820_Packed.h"
+#include "OneWire.h"
+
+static const uint8_t Families[DS1820_PACKED_FAMILY_COUNT] = DS1820_PACKED_FAMILIES;
+
+/* Internal functions */
+static int EntryCompare(const DS1820_PackedAddress *A, const DS1820_PackedAddress *B);
+static int EntrySearch(const DS1820_PackedTable *Table, const DS1820_PackedAddress *Packed, int *iFound);
+
+/**
+ * Calculates ROM CRC over family code and serial number.
+ * @param iAddress 64bit device address, CRC byte is ignored.
+ * @return CRC byte.
+ */
+uint8_t DS1820_AddressCRC(uint64_t iAddress) {
+    int i;
+    uint8_t iCRC = 0;
+
+    for (i = 0; i < 7; i++)
+        iCRC = OW_CRCCalculate(iCRC, (uint8_t) (iAddress >> (8 * i)));
+
+    return iCRC;
+}
+
+/**
+ * Packs 64bit address.
+ * @param iAddress 64bit device address.
+ * @param Packed Packed address output.
+ * @return DS1820_OK if successfull, DS1820_ERROR if family code is unknown or 
+ * CRC do not match.
+ */
+DS1820_State DS1820_AddressPack(uint64_t iAddress, DS1820_PackedAddress *Packed) {
+    int i;
+    uint8_t iFamily = (uint8_t) iAddress;
+
+    if (DS1820_AddressCRC(iAddress) != (uint8_t) (iAddress >> 56)) return DS1820_ERROR;
+
+    for (i = 0; i < DS1820_PACKED_FAMILY_COUNT; i++)
+        if (Families[i] == iFamily) break;
+
+    if (i == DS1820_PACKED_FAMILY_COUNT) return DS1820_ERROR;
+
+    Packed->iFamily = (uint8_t) i;
+
+    /* Most significant serial byte first */
+    for (i = 0; i < DS1820_SERIAL_LENGTH; i++)
+        Packed->Serial[i] = (uint8_t) (iAddress >> (8 * (DS1820_SERIAL_LENGTH - i)));
+
+    return DS1820_OK;
+}
+
+/**
+ * Unpacks address and recalculates its CRC.
+ * @param Packed Packed address.
+ * @return 64bit device address or DS1820_ADDRESS_ALL if family index is 
+ * invalid.
+ */
+uint64_t DS1820_AddressUnpack(const DS1820_PackedAddress *Packed) {
+    int i;
+    uint64_t iAddress;
+
+    if (Packed->iFamily >= DS1820_PACKED_FAMILY_COUNT) return DS1820_ADDRESS_ALL;
+
+    iAddress = Families[Packed->iFamily];
+
+    for (i = 0; i < DS1820_SERIAL_LENGTH; i++)
+        iAddress |= (uint64_t) Packed->Serial[i] << (8 * (DS1820_SERIAL_LENGTH - i));
+
+    return iAddress | ((uint64_t) DS1820_AddressCRC(iAddress) << 56);
+}
+
+/**
+ * Initializes empty packed table.
+ * @param Table Table to be initialized.
+ * @param Entries Array for iMax entries.
+ * @param iMax Table capacity.
+ */
+void DS1820_PackedTableInit(DS1820_PackedTable *Table, DS1820_PackedAddress *Entries, int iMax) {
+    Table->Entries = Entries;
+    Table->iCount = 0;
+    Table->iMax = iMax;
+}
+
+/**
+ * Adds device into packed table. Indexes of devices behind the new one are 
+ * shifted by one, indexes returned before are not valid after a new device is
+ * added.
+ * @param Table Packed table.
+ * @param iAddress 64bit device address.
+ * @return Device index or -1 if table is full or address can not be packed.
+ */
+int DS1820_PackedTableAdd(DS1820_PackedTable *Table, uint64_t iAddress) {
+    DS1820_PackedAddress Packed;
+    int iFound, iIndex;
+
+    if (DS1820_AddressPack(iAddress, &Packed) != DS1820_OK) return -1;
+
+    iIndex = EntrySearch(Table, &Packed, &iFound);
+    if (iFound) return iIndex;
+
+    if (Table->iCount >= Table->iMax) return -1;
+
+    memmove(&Table->Entries[iIndex + 1], &Table->Entries[iIndex],
+            (Table->iCount - iIndex) * sizeof(DS1820_PackedAddress));
+    Table->Entries[iIndex] = Packed;
+    Table->iCount++;
+
+    return iIndex;
+}
+
+/**
+ * Finds device in packed table.
+ * @param Table Packed table.
+ * @param iAddress 64bit device address.
+ * @return Device index or -1 if not found.
+ */
+int DS1820_PackedTableFind(const DS1820_PackedTable *Table, uint64_t iAddress) {
+    DS1820_PackedAddress Packed;
+    int iFound, iIndex;
+
+    if (DS1820_AddressPack(iAddress, &Packed) != DS1820_OK) return -1;
+
+    iIndex = EntrySearch(Table, &Packed, &iFound);
+
+    return (iFound) ? iIndex : -1;
+}
+
+/**
+ * Returns address of device from packed table.
+ * @param Table Packed table.
+ * @param iIndex Device index.
+ * @return 64bit device address or DS1820_ADDRESS_ALL if index is invalid.
+ */
+uint64_t DS1820_PackedTableAddress(const DS1820_PackedTable *Table, int iIndex) {
+    if ((iIndex < 0) || (iIndex >= Table->iCount)) return DS1820_ADDRESS_ALL;
+
+    return DS1820_AddressUnpack(&Table->Entries[iIndex]);
+}
+
+/**
+ * Compares two packed addresses.
+ * @return Negative, zero or positive as memcmp.
+ */
+int EntryCompare(const DS1820_PackedAddress *A, const DS1820_PackedAddress *B) {
+    int iResult = memcmp(A->Serial, B->Serial, DS1820_SERIAL_LENGTH);
+
+    return (iResult) ? iResult : (int) A->iFamily - (int) B->iFamily;
+}
+
+/**
+ * Binary search in sorted table.
+ * @param Table Packed table.
+ * @param Packed Searched address.
+ * @param iFound Set to 1 if found, 0 if not.
+ * @return Index of address or index where it should be inserted.
+ */
+int EntrySearch(const DS1820_PackedTable *Table, const DS1820_PackedAddress *Packed, int *iFound) {
+    int iLow = 0, iHigh = Table->iCount, iMiddle, iResult;
+
+    while (iLow < iHigh) {
+        iMiddle = (iLow + iHigh) / 2;
+        iResult = EntryCompare(&Table->Entries[iMiddle], Packed);
+
+        if (iResult == 0) {
+            (*iFound) = 1;
+            return iMiddle;
+        }
+
+        if (iResult < 0) iLow = iMiddle + 1;
+        else iHigh = iMiddle;
+    }
+
+    (*iFound) = 0;
+    return iLow;
+}
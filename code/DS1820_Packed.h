@@ -0,0 +1,60 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Packed.h
+ * @author  Vojtech Vigner
+ * @brief   Compressed ROM address storage: 48bit serial number and family 
+ *          index, CRC is recalculated on demand.
+ *          
+ * @see     DS1820_Packed.c documentation
+ *******************************************************************************
+ */
+
+#ifndef DS1820_PACKED_H
+#define	DS1820_PACKED_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "DS1820.h"
+
+    /* Family codes which can be packed, index is stored instead of the code */
+#define DS1820_PACKED_FAMILIES  { DS1820_FAMILY_CODE, 0x28, 0x22, 0x3B, 0x42 }
+#define DS1820_PACKED_FAMILY_COUNT  5
+
+    /* Serial number length in bytes */
+#define DS1820_SERIAL_LENGTH    6
+
+    /* Packed address, 7 bytes without padding, serial is stored most 
+     * significant byte first so entries can be compared by memcmp */
+    typedef struct _DS1820_PackedAddress {
+        uint8_t Serial[DS1820_SERIAL_LENGTH];
+        uint8_t iFamily;
+    } DS1820_PackedAddress;
+
+    /* Sorted table of packed addresses in caller provided memory, device 
+     * index is a position in the table and changes when a device is added */
+    typedef struct _DS1820_PackedTable {
+        DS1820_PackedAddress *Entries;
+        int iCount;
+        int iMax;
+    } DS1820_PackedTable;
+
+    /* Conversion helpers */
+    uint8_t DS1820_AddressCRC(uint64_t iAddress);
+    DS1820_State DS1820_AddressPack(uint64_t iAddress, DS1820_PackedAddress *Packed);
+    uint64_t DS1820_AddressUnpack(const DS1820_PackedAddress *Packed);
+
+    /* Packed device table */
+    void DS1820_PackedTableInit(DS1820_PackedTable *Table, DS1820_PackedAddress *Entries, int iMax);
+    int DS1820_PackedTableAdd(DS1820_PackedTable *Table, uint64_t iAddress);
+    int DS1820_PackedTableFind(const DS1820_PackedTable *Table, uint64_t iAddress);
+    uint64_t DS1820_PackedTableAddress(const DS1820_PackedTable *Table, int iIndex);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DS1820_PACKED_H */
+
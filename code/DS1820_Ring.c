@@ -0,0 +1,141 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Ring.c
+ * @author  Vojtech Vigner
+ * @brief   Lock-free single producer / single consumer rings of timestamped
+ *          samples, one ring per device of the DS1820 device table.
+ * 
+ * @attention   
+ *          Exactly one task may push into a ring (usually the bus task by 
+ *          the read engine) and exactly one task may drain it. Producer never
+ *          blocks, samples are dropped and counted when the ring is full.
+ * 
+ * @verbatim
+ *          ********************************************************************
+ *                                How to use this module
+ *          ********************************************************************
+ *          1. Register DS1820_RingSink by DS1820_SampleSinkAdd.
+ * 
+ *          2. Call DS1820_TemperatureReadAll from the bus task.
+ *
+ *          3. Drain samples by DS1820_RingDrain from the consumer task.
+ *  @endverbatim  
+ *******************************************************************************
+ */
+#include "DS1820_Ring.h"
+
+#if (DS1820_RING_SIZE & (DS1820_RING_SIZE - 1))
+#error "DS1820_RING_SIZE has to be power of two"
+#endif
+
+#define RING_MASK   (DS1820_RING_SIZE - 1)
+
+/* Ring indexes are free running, producer and consumer own one cache line 
+ * each, drop counter is written by producer only */
+typedef struct _DS1820_Ring {
+    volatile uint32_t iHead __attribute__((aligned(DS1820_CACHE_LINE)));
+    uint32_t iDropped;
+    volatile uint32_t iTail __attribute__((aligned(DS1820_CACHE_LINE)));
+    DS1820_Sample Samples[DS1820_RING_SIZE] __attribute__((aligned(DS1820_CACHE_LINE)));
+} DS1820_Ring;
+
+static DS1820_Ring Rings[DS1820_MAX_DEVICES];
+
+/**
+ * Stores sample into device ring, producer side.
+ * @param iDevice Device index in the device table.
+ * @param iTime Sample timestamp.
+ * @param iTemp Temperature in degrees of Celsius * 10.
+ * @return DS1820_OK if successfull, DS1820_ERROR if ring is full or index is
+ * invalid.
+ */
+DS1820_State DS1820_RingPush(int iDevice, uint32_t iTime, int iTemp) {
+    DS1820_Ring *Ring;
+    uint32_t iHead;
+
+    if ((iDevice < 0) || (iDevice >= DS1820_MAX_DEVICES)) return DS1820_ERROR;
+
+    Ring = &Rings[iDevice];
+    iHead = Ring->iHead;
+
+    /* Drop sample if consumer is too slow */
+    if (iHead - __atomic_load_n(&Ring->iTail, __ATOMIC_ACQUIRE) >= DS1820_RING_SIZE) {
+        __atomic_store_n(&Ring->iDropped, Ring->iDropped + 1, __ATOMIC_RELAXED);
+        return DS1820_ERROR;
+    }
+
+    Ring->Samples[iHead & RING_MASK].iTime = iTime;
+    Ring->Samples[iHead & RING_MASK].iTemp = iTemp;
+
+    /* Publish sample */
+    __atomic_store_n(&Ring->iHead, iHead + 1, __ATOMIC_RELEASE);
+
+    return DS1820_OK;
+}
+
+/**
+ * Read engine consumer, see DS1820_SampleSinkAdd.
+ * @param iDevice Device index in the device table.
+ * @param iTime Sample timestamp.
+ * @param iTemp Temperature in degrees of Celsius * 10.
+ */
+void DS1820_RingSink(int iDevice, uint32_t iTime, int iTemp) {
+    DS1820_RingPush(iDevice, iTime, iTemp);
+}
+
+/**
+ * Moves all available samples of device, up to iMax, into array, consumer 
+ * side.
+ * @param iDevice Device index in the device table.
+ * @param Samples Output array.
+ * @param iMax Output array length.
+ * @return Number of samples stored into array.
+ */
+int DS1820_RingDrain(int iDevice, DS1820_Sample *Samples, int iMax) {
+    DS1820_Ring *Ring;
+    uint32_t iHead, iTail;
+    int iCount = 0;
+
+    if ((iDevice < 0) || (iDevice >= DS1820_MAX_DEVICES)) return 0;
+
+    Ring = &Rings[iDevice];
+    iTail = Ring->iTail;
+    iHead = __atomic_load_n(&Ring->iHead, __ATOMIC_ACQUIRE);
+
+    while ((iTail != iHead) && (iCount < iMax)) {
+        Samples[iCount++] = Ring->Samples[iTail & RING_MASK];
+        iTail++;
+    }
+
+    /* Release slots to producer */
+    __atomic_store_n(&Ring->iTail, iTail, __ATOMIC_RELEASE);
+
+    return iCount;
+}
+
+/**
+ * Returns number of samples waiting in device ring.
+ * @param iDevice Device index in the device table.
+ * @return Number of samples.
+ */
+int DS1820_RingCount(int iDevice) {
+    DS1820_Ring *Ring;
+
+    if ((iDevice < 0) || (iDevice >= DS1820_MAX_DEVICES)) return 0;
+
+    Ring = &Rings[iDevice];
+
+    return (int) (__atomic_load_n(&Ring->iHead, __ATOMIC_ACQUIRE) -
+            __atomic_load_n(&Ring->iTail, __ATOMIC_ACQUIRE));
+}
+
+/**
+ * Returns number of samples dropped because device ring was full.
+ * @param iDevice Device index in the device table.
+ * @return Number of dropped samples.
+ */
+uint32_t DS1820_RingDropped(int iDevice) {
+    if ((iDevice < 0) || (iDevice >= DS1820_MAX_DEVICES)) return 0;
+
+    return __atomic_load_n(&Rings[iDevice].iDropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,53 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Ring.h
+ * @author  Vojtech Vigner
+ * @brief   Lock-free single producer / single consumer rings of timestamped
+ *          samples, one ring per device of the DS1820 device table.
+ *          
+ * @see     DS1820_Ring.c documentation
+ *******************************************************************************
+ */
+
+#ifndef DS1820_RING_H
+#define	DS1820_RING_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "DS1820.h"
+
+    /* Ring capacity in samples, has to be power of two */
+#ifndef DS1820_RING_SIZE
+#define DS1820_RING_SIZE        8
+#endif
+
+    /* Cache line size used to separate producer and consumer data, 64 bytes
+     * on host processors, MCU builds may define less to save memory */
+#ifndef DS1820_CACHE_LINE
+#define DS1820_CACHE_LINE       64
+#endif
+
+    /* Timestamped sample */
+    typedef struct _DS1820_Sample {
+        uint32_t iTime;
+        int32_t iTemp;
+    } DS1820_Sample;
+
+    /* Producer side */
+    DS1820_State DS1820_RingPush(int iDevice, uint32_t iTime, int iTemp);
+    void DS1820_RingSink(int iDevice, uint32_t iTime, int iTemp);
+
+    /* Consumer side */
+    int DS1820_RingDrain(int iDevice, DS1820_Sample *Samples, int iMax);
+    int DS1820_RingCount(int iDevice);
+    uint32_t DS1820_RingDropped(int iDevice);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DS1820_RING_H */
+
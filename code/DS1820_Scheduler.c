@@ -0,0 +1,261 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Scheduler.c
+ * @author  Vojtech Vigner
+ * @brief   Earliest deadline first sampling scheduler for devices from the 
+ *          device table with per device period and deadline.
+ * 
+ * @attention   
+ *          Every registered device releases a job each period, the job has to
+ *          be read within its relative deadline. Conversion is broadcasted 
+ *          to all devices and started up to conversion time before the 
+ *          earliest pending release, so the value is ready at release. The 
+ *          bus is not used during conversion. Ready jobs are read one by one
+ *          in the order of their deadlines, a job which can not be read before
+ *          its deadline (read cost included) is dropped and counted as missed,
+ *          so late jobs do not delay the others. Read cost is used only for
+ *          this admission and for planning. Jobs are read directly by
+ *          DS1820_TemperatureReadHandle, regardless of read engine backoff,
+ *          failed reading is counted and retried one read cost later while
+ *          the deadline allows. Device which lost power or missed the 
+ *          conversion is not retried, it waits for a new conversion if the
+ *          deadline leaves time for it. Latency is measured by DS1820_TickGet
+ *          from release to the end of reading, reading which ends after the
+ *          deadline (retries of the driver, slow bus) is counted as missed.
+ * 
+ * @verbatim
+ *          ********************************************************************
+ *                                How to use this module
+ *          ********************************************************************
+ *          1. Set conversion time and read cost by DS1820_SchedulerInit.
+ * 
+ *          2. Register devices by DS1820_SchedulerAdd.
+ *
+ *          3. Call DS1820_SchedulerRun repeatedly, it performs at most one bus
+ *          transaction and returns time to the next action. Readings are 
+ *          passed to the read engine consumers.
+ *  @endverbatim  
+ *******************************************************************************
+ */
+#include "DS1820_Scheduler.h"
+
+/* Job state flags */
+#define JOB_REGISTERED      0x01
+#define JOB_COVERED         0x02
+#define JOB_READY           0x04
+
+typedef struct _DS1820_Job {
+    uint32_t iPeriod;
+    uint32_t iDeadline;
+    uint32_t iRelease;
+    uint8_t iFlags;
+    DS1820_SchedulerStats Stats;
+} DS1820_Job;
+
+static DS1820_Job Jobs[DS1820_MAX_DEVICES];
+static uint32_t iConversion = 750;
+static uint32_t iCost = 15;
+static uint32_t iConvertStart;
+static uint8_t bConverting = 0;
+
+/* Internal functions */
+static void JobNext(DS1820_Job *Job, uint32_t iNow);
+static int TimeBefore(uint32_t iA, uint32_t iB);
+
+/**
+ * Sets bus timing and unregisters all devices.
+ * @param iConversionTime Temperature conversion time in tick units (see 
+ * DS1820_TickSet), 750 ms for DS1820.
+ * @param iReadCost Duration of one reading transaction in tick units.
+ */
+void DS1820_SchedulerInit(uint32_t iConversionTime, uint32_t iReadCost) {
+    int i;
+
+    for (i = 0; i < DS1820_MAX_DEVICES; i++) Jobs[i].iFlags = 0;
+
+    iConversion = iConversionTime;
+    iCost = iReadCost;
+    bConverting = 0;
+}
+
+/**
+ * Registers device for periodic reading.
+ * @param iDevice Device handle.
+ * @param iPeriod Reading period in tick units.
+ * @param iDeadline Relative deadline in tick units, at most iPeriod.
+ * @param iStart Time of the first release.
+ * @return DS1820_OK if successfull, DS1820_ERROR if parameters are invalid.
+ */
+DS1820_State DS1820_SchedulerAdd(int iDevice, uint32_t iPeriod, uint32_t iDeadline, uint32_t iStart) {
+    DS1820_Job *Job;
+
+    if ((iDevice < 0) || (iDevice >= DS1820_MAX_DEVICES)) return DS1820_ERROR;
+    if ((iPeriod == 0) || (iDeadline == 0) || (iDeadline > iPeriod)) return DS1820_ERROR;
+
+    Job = &Jobs[iDevice];
+    Job->iPeriod = iPeriod;
+    Job->iDeadline = iDeadline;
+    Job->iRelease = iStart;
+    Job->iFlags = JOB_REGISTERED;
+    Job->Stats.iCompleted = 0;
+    Job->Stats.iMissed = 0;
+    Job->Stats.iFailed = 0;
+    Job->Stats.iLastError = DS1820_OK;
+    Job->Stats.iLastLatency = 0;
+    Job->Stats.iWorstLatency = 0;
+
+    return DS1820_OK;
+}
+
+/**
+ * Unregisters device.
+ * @param iDevice Device handle.
+ * @return DS1820_OK if successfull, DS1820_ERROR if handle is invalid.
+ */
+DS1820_State DS1820_SchedulerRemove(int iDevice) {
+    if ((iDevice < 0) || (iDevice >= DS1820_MAX_DEVICES)) return DS1820_ERROR;
+
+    Jobs[iDevice].iFlags = 0;
+
+    return DS1820_OK;
+}
+
+/**
+ * Performs the next scheduled action: drops late jobs, starts conversion or
+ * reads the ready job with the earliest deadline.
+ * @param iNow Current time in tick units.
+ * @return Time until the next action in tick units.
+ */
+uint32_t DS1820_SchedulerRun(uint32_t iNow) {
+    int i, iBest = -1;
+    uint32_t iWait = 0xFFFFFFFF, iEvent, iStart;
+    DS1820_Job *Job;
+
+    /* Conversion completed, covered jobs become ready */
+    if ((bConverting) && !TimeBefore(iNow, iConvertStart + iConversion)) {
+        bConverting = 0;
+        for (i = 0; i < DS1820_MAX_DEVICES; i++)
+            if (Jobs[i].iFlags & JOB_COVERED) Jobs[i].iFlags = (Jobs[i].iFlags & ~JOB_COVERED) | JOB_READY;
+    }
+
+    for (i = 0; i < DS1820_MAX_DEVICES; i++) {
+        Job = &Jobs[i];
+        if (!(Job->iFlags & JOB_REGISTERED)) continue;
+
+        /* Job can not be completed in time */
+        if (TimeBefore(Job->iRelease + Job->iDeadline, iNow + iCost)) {
+            Job->Stats.iMissed++;
+            JobNext(Job, iNow);
+        }
+
+        /* Earliest deadline among ready and released jobs */
+        if ((Job->iFlags & JOB_READY) && !TimeBefore(iNow, Job->iRelease) &&
+                ((iBest < 0) || TimeBefore(Job->iRelease + Job->iDeadline,
+                Jobs[iBest].iRelease + Jobs[iBest].iDeadline)))
+            iBest = i;
+    }
+
+    /* Bus is busy by conversion */
+    if (bConverting) return iConvertStart + iConversion - iNow;
+
+    if (iBest >= 0) {
+        Job = &Jobs[iBest];
+
+        iStart = DS1820_TickGet();
+        Job->Stats.iLastError = DS1820_TemperatureReadHandle(iBest);
+        iNow += DS1820_TickGet() - iStart;
+
+        /* Device holds no fresh conversion, convert again if there is time */
+        if ((Job->Stats.iLastError == DS1820_POWER_ON_RESET) || (Job->Stats.iLastError == DS1820_STALE)) {
+            Job->Stats.iFailed++;
+            if (TimeBefore(Job->iRelease + Job->iDeadline, iNow + iConversion + iCost)) {
+                Job->Stats.iMissed++;
+                JobNext(Job, iNow);
+            } else {
+                Job->iFlags &= ~JOB_READY;
+            }
+            return 0;
+        }
+
+        /* Failed reading is retried after read cost until its deadline */
+        if (Job->Stats.iLastError != DS1820_OK) {
+            Job->Stats.iFailed++;
+            return iCost;
+        }
+
+        /* Measured latency, reading which ended late missed its deadline */
+        Job->Stats.iLastLatency = iNow - Job->iRelease;
+        if (Job->Stats.iLastLatency > Job->Stats.iWorstLatency)
+            Job->Stats.iWorstLatency = Job->Stats.iLastLatency;
+        if (TimeBefore(Job->iRelease + Job->iDeadline, iNow)) Job->Stats.iMissed++;
+        else Job->Stats.iCompleted++;
+        JobNext(Job, iNow);
+
+        return 0;
+    }
+
+    /* Start conversion for jobs released within conversion time */
+    for (i = 0; i < DS1820_MAX_DEVICES; i++) {
+        Job = &Jobs[i];
+        if (!(Job->iFlags & JOB_REGISTERED) || (Job->iFlags & JOB_READY)) continue;
+
+        if (!TimeBefore(iNow + iConversion, Job->iRelease)) {
+            if (!bConverting) {
+                if (DS1820_TemperatureConvert(DS1820_ADDRESS_ALL) != DS1820_OK) return iCost;
+                bConverting = 1;
+                iConvertStart = iNow;
+            }
+            Job->iFlags |= JOB_COVERED;
+        } else {
+            iEvent = Job->iRelease - iConversion - iNow;
+            if (iEvent < iWait) iWait = iEvent;
+        }
+    }
+
+    if (bConverting) return iConversion;
+
+    /* Ready jobs waiting for release */
+    for (i = 0; i < DS1820_MAX_DEVICES; i++) {
+        Job = &Jobs[i];
+        if ((Job->iFlags & JOB_READY) && ((iEvent = Job->iRelease - iNow) < iWait)) iWait = iEvent;
+    }
+
+    return iWait;
+}
+
+/**
+ * Returns scheduling statistics of device.
+ * @param iDevice Device handle.
+ * @param Stats Statistics output.
+ * @return DS1820_OK if successfull, DS1820_ERROR if device is not registered.
+ */
+DS1820_State DS1820_SchedulerStatsGet(int iDevice, DS1820_SchedulerStats *Stats) {
+    if ((iDevice < 0) || (iDevice >= DS1820_MAX_DEVICES)) return DS1820_ERROR;
+    if (!(Jobs[iDevice].iFlags & JOB_REGISTERED)) return DS1820_ERROR;
+
+    (*Stats) = Jobs[iDevice].Stats;
+
+    return DS1820_OK;
+}
+
+/**
+ * Releases the next job of device, periods which already passed are skipped
+ * and counted as missed.
+ */
+void JobNext(DS1820_Job *Job, uint32_t iNow) {
+    Job->iFlags &= ~(JOB_COVERED | JOB_READY);
+    Job->iRelease += Job->iPeriod;
+
+    while (TimeBefore(Job->iRelease + Job->iDeadline, iNow + iCost)) {
+        Job->Stats.iMissed++;
+        Job->iRelease += Job->iPeriod;
+    }
+}
+
+/**
+ * Compares timestamps with overflow.
+ * @return 1 if iA is before iB.
+ */
+int TimeBefore(uint32_t iA, uint32_t iB) {
+    return (int32_t) (iA - iB) < 0;
+}
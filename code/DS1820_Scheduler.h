@@ -0,0 +1,50 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Scheduler.h
+ * @author  Vojtech Vigner
+ * @brief   Earliest deadline first sampling scheduler for devices from the 
+ *          device table with per device period and deadline.
+ *          
+ * @see     DS1820_Scheduler.c documentation
+ *******************************************************************************
+ */
+
+#ifndef DS1820_SCHEDULER_H
+#define	DS1820_SCHEDULER_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "DS1820.h"
+
+    /* Device scheduling statistics, latencies are measured from release to
+     * the end of reading in tick units, failed readings are retried within 
+     * the deadline */
+    typedef struct _DS1820_SchedulerStats {
+        uint32_t iCompleted;
+        uint32_t iMissed;
+        uint32_t iFailed;
+        DS1820_State iLastError;
+        uint32_t iLastLatency;
+        uint32_t iWorstLatency;
+    } DS1820_SchedulerStats;
+
+    /* Configuration */
+    void DS1820_SchedulerInit(uint32_t iConversionTime, uint32_t iReadCost);
+    DS1820_State DS1820_SchedulerAdd(int iDevice, uint32_t iPeriod, uint32_t iDeadline, uint32_t iStart);
+    DS1820_State DS1820_SchedulerRemove(int iDevice);
+
+    /* Scheduling */
+    uint32_t DS1820_SchedulerRun(uint32_t iNow);
+
+    /* Results */
+    DS1820_State DS1820_SchedulerStatsGet(int iDevice, DS1820_SchedulerStats *Stats);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DS1820_SCHEDULER_H */
+
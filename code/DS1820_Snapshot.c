@@ -0,0 +1,250 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Snapshot.c
+ * @author  Vojtech Vigner
+ * @brief   Table of latest readings keyed by device address, protected by 
+ *          per-row sequence counters (seqlock). One writer, many readers.
+ * 
+ * @attention   
+ *          Writer makes row sequence odd, updates the row and makes sequence
+ *          even again. Readers copy the row and retry if sequence was odd or
+ *          changed meanwhile, no locks or atomic read-modify-write are used.
+ *          Row address is claimed the same way, so readers never see a torn
+ *          64bit address on 32bit targets. Readers give up after
+ *          DS1820_SNAPSHOT_RETRIES attempts, e.g. if the writer died while 
+ *          writing the row. Table contains no pointers, it can be placed in
+ *          POSIX shared memory and read by other processes.
+ * 
+ * @verbatim
+ *          ********************************************************************
+ *                                How to use this module
+ *          ********************************************************************
+ *          1. Allocate DS1820_SNAPSHOT_SIZE(iRows) bytes (static buffer or 
+ *          shm_open and mmap) and initialize it by DS1820_SnapshotInit.
+ * 
+ *          2. Register DS1820_SnapshotSink by DS1820_SampleSinkAdd or publish
+ *          readings by DS1820_SnapshotPublish.
+ *
+ *          3. Readers map the same memory, check it by DS1820_SnapshotOpen and
+ *          read rows by DS1820_SnapshotRead.
+ *  @endverbatim  
+ *******************************************************************************
+ */
+#include <string.h>
+#include "DS1820_Snapshot.h"
+
+/* Table written by the read engine consumer */
+static DS1820_SnapshotTable *SinkTable = 0;
+
+/* Internal functions */
+static DS1820_SnapshotRow *RowFind(const DS1820_SnapshotTable *Table, uint64_t iAddress, int bCreate, DS1820_State *iState);
+static uint32_t RowBegin(DS1820_SnapshotRow *Row);
+static void RowEnd(DS1820_SnapshotRow *Row, uint32_t iSequence);
+static int ReadBegin(const DS1820_SnapshotRow *Row, uint32_t *iSequence);
+static int ReadEnd(const DS1820_SnapshotRow *Row, uint32_t iSequence);
+
+/**
+ * Initializes empty table. The table is also used by DS1820_SnapshotSink.
+ * @param pMemory Memory of at least DS1820_SNAPSHOT_SIZE(iRows) bytes, aligned
+ * to 8 bytes.
+ * @param iRows Number of rows, has to be power of two and should be at least
+ * twice the number of devices.
+ * @return Pointer to table or NULL if iRows is not power of two.
+ */
+DS1820_SnapshotTable *DS1820_SnapshotInit(void *pMemory, uint32_t iRows) {
+    DS1820_SnapshotTable *Table = (DS1820_SnapshotTable *) pMemory;
+
+    if ((iRows == 0) || (iRows & (iRows - 1))) return 0;
+
+    memset(pMemory, 0, DS1820_SNAPSHOT_SIZE(iRows));
+    Table->iRows = iRows;
+
+    /* Mark table valid after it is cleared */
+    __atomic_store_n(&Table->iMagic, DS1820_SNAPSHOT_MAGIC, __ATOMIC_RELEASE);
+
+    SinkTable = Table;
+
+    return Table;
+}
+
+/**
+ * Opens table initialized by DS1820_SnapshotInit, e.g. in another process.
+ * @param pMemory Table memory.
+ * @return Pointer to table or NULL if memory does not contain a table.
+ */
+DS1820_SnapshotTable *DS1820_SnapshotOpen(void *pMemory) {
+    DS1820_SnapshotTable *Table = (DS1820_SnapshotTable *) pMemory;
+
+    if (__atomic_load_n(&Table->iMagic, __ATOMIC_ACQUIRE) != DS1820_SNAPSHOT_MAGIC) return 0;
+
+    return Table;
+}
+
+/**
+ * Publishes new reading of device, writer side.
+ * @param Table Snapshot table.
+ * @param iAddress 64bit device address.
+ * @param iTime Reading timestamp.
+ * @param iTemp Temperature in degrees of Celsius * 10.
+ * @return DS1820_OK if successfull, DS1820_ERROR if table is full.
+ */
+DS1820_State DS1820_SnapshotPublish(DS1820_SnapshotTable *Table, uint64_t iAddress, uint32_t iTime, int iTemp) {
+    DS1820_SnapshotRow *Row = RowFind(Table, iAddress, 1, 0);
+    uint32_t iSequence;
+
+    if (Row == 0) return DS1820_ERROR;
+
+    iSequence = RowBegin(Row);
+    Row->iTime = iTime;
+    Row->iTemp = iTemp;
+    Row->iCount++;
+    RowEnd(Row, iSequence);
+
+    return DS1820_OK;
+}
+
+/**
+ * Read engine consumer publishing into table from DS1820_SnapshotInit, see 
+ * DS1820_SampleSinkAdd.
+ * @param iDevice Device index in the device table.
+ * @param iTime Sample timestamp.
+ * @param iTemp Temperature in degrees of Celsius * 10.
+ */
+void DS1820_SnapshotSink(int iDevice, uint32_t iTime, int iTemp) {
+    if (SinkTable == 0) return;
+
+    DS1820_SnapshotPublish(SinkTable, DS1820_DeviceAddress(iDevice), iTime, iTemp);
+}
+
+/**
+ * Reads consistent copy of device row, reader side. Row with zero iCount has
+ * not been published yet.
+ * @param Table Snapshot table.
+ * @param iAddress 64bit device address.
+ * @param Row Row copy output.
+ * @return DS1820_OK if successfull, DS1820_ERROR if device is not in table,
+ * DS1820_BUSY if a row stayed in writing for DS1820_SNAPSHOT_RETRIES attempts
+ * (writer preempted or dead), try again later.
+ */
+DS1820_State DS1820_SnapshotRead(const DS1820_SnapshotTable *Table, uint64_t iAddress, DS1820_SnapshotRow *Row) {
+    DS1820_State iState = DS1820_ERROR;
+    DS1820_SnapshotRow *Source = RowFind(Table, iAddress, 0, &iState);
+    uint32_t i, iSequence;
+
+    if (Source == 0) return iState;
+
+    for (i = 0; i < DS1820_SNAPSHOT_RETRIES; i++) {
+        if (!ReadBegin(Source, &iSequence)) continue;
+
+        Row->iTime = Source->iTime;
+        Row->iTemp = Source->iTemp;
+        Row->iCount = Source->iCount;
+
+        if (ReadEnd(Source, iSequence)) {
+            Row->iSequence = iSequence;
+            Row->iAddress = iAddress;
+            return DS1820_OK;
+        }
+    }
+
+    return DS1820_BUSY;
+}
+
+/**
+ * Finds device row by linear probing. Writer reads addresses directly, only
+ * it changes them. Readers copy addresses under the row sequence.
+ * @param Table Snapshot table.
+ * @param iAddress 64bit device address.
+ * @param bCreate Claim empty row if device is not in table, writer only.
+ * @param iState Reader failure output, DS1820_BUSY if address of a row could
+ * not be read, NULL for writer.
+ * @return Pointer to row or NULL if not found.
+ */
+DS1820_SnapshotRow *RowFind(const DS1820_SnapshotTable *Table, uint64_t iAddress, int bCreate, DS1820_State *iState) {
+    DS1820_SnapshotRow *Row;
+    uint32_t i, j, iSequence, iMask = Table->iRows - 1;
+    uint32_t iSlot = DS1820_ADDRESS_HASH(iAddress) & iMask;
+    uint64_t iRowAddress = DS1820_ADDRESS_ALL;
+
+    if (iAddress == DS1820_ADDRESS_ALL) return 0;
+
+    for (i = 0; i < Table->iRows; i++) {
+        Row = (DS1820_SnapshotRow *) &Table->Rows[(iSlot + i) & iMask];
+
+        if (iState == 0) {
+            iRowAddress = Row->iAddress;
+        } else {
+            for (j = 0; j < DS1820_SNAPSHOT_RETRIES; j++) {
+                if (!ReadBegin(Row, &iSequence)) continue;
+                iRowAddress = Row->iAddress;
+                if (ReadEnd(Row, iSequence)) break;
+            }
+
+            if (j == DS1820_SNAPSHOT_RETRIES) {
+                *iState = DS1820_BUSY;
+                return 0;
+            }
+        }
+
+        if (iRowAddress == iAddress) return Row;
+
+        if (iRowAddress == DS1820_ADDRESS_ALL) {
+            if (!bCreate) return 0;
+
+            /* Address is written once, before the first publication */
+            iSequence = RowBegin(Row);
+            Row->iAddress = iAddress;
+            RowEnd(Row, iSequence);
+            return Row;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Starts writing of row, makes its sequence odd.
+ * @param Row Table row.
+ * @return Even sequence before writing.
+ */
+uint32_t RowBegin(DS1820_SnapshotRow *Row) {
+    uint32_t iSequence = Row->iSequence;
+
+    __atomic_store_n(&Row->iSequence, iSequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    return iSequence;
+}
+
+/**
+ * Ends writing of row, makes its sequence even, the row is consistent.
+ * @param Row Table row.
+ * @param iSequence Sequence returned by RowBegin.
+ */
+void RowEnd(DS1820_SnapshotRow *Row, uint32_t iSequence) {
+    __atomic_store_n(&Row->iSequence, iSequence + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * Starts reading of row.
+ * @param Row Table row.
+ * @param iSequence Sequence output.
+ * @return 1 if row can be copied, 0 if it is being written.
+ */
+int ReadBegin(const DS1820_SnapshotRow *Row, uint32_t *iSequence) {
+    *iSequence = __atomic_load_n(&Row->iSequence, __ATOMIC_ACQUIRE);
+
+    return !(*iSequence & 1);
+}
+
+/**
+ * Ends reading of row.
+ * @param Row Table row.
+ * @param iSequence Sequence from ReadBegin.
+ * @return 1 if the copy is consistent, 0 if the row changed meanwhile.
+ */
+int ReadEnd(const DS1820_SnapshotRow *Row, uint32_t iSequence) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n(&Row->iSequence, __ATOMIC_RELAXED) == iSequence;
+}
@@ -0,0 +1,64 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Snapshot.h
+ * @author  Vojtech Vigner
+ * @brief   Table of latest readings keyed by device address, protected by 
+ *          per-row sequence counters (seqlock). One writer, many readers.
+ *          
+ * @see     DS1820_Snapshot.c documentation
+ *******************************************************************************
+ */
+
+#ifndef DS1820_SNAPSHOT_H
+#define	DS1820_SNAPSHOT_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "DS1820.h"
+
+    /* Table identification */
+#define DS1820_SNAPSHOT_MAGIC   0x44535331
+
+    /* Reader attempts to copy a row which is being written */
+#ifndef DS1820_SNAPSHOT_RETRIES
+#define DS1820_SNAPSHOT_RETRIES 1000
+#endif
+
+    /* Memory needed for table with iRows rows */
+#define DS1820_SNAPSHOT_SIZE(iRows) \
+    (sizeof(DS1820_SnapshotTable) + (iRows) * sizeof(DS1820_SnapshotRow))
+
+    /* Table row, all fields are valid only in copy returned by reader */
+    typedef struct _DS1820_SnapshotRow {
+        volatile uint32_t iSequence;
+        volatile uint32_t iTime;
+        volatile uint64_t iAddress;
+        volatile int32_t iTemp;
+        volatile uint32_t iCount;
+    } DS1820_SnapshotRow;
+
+    /* Table header followed by rows, contains no pointers */
+    typedef struct _DS1820_SnapshotTable {
+        uint32_t iMagic;
+        uint32_t iRows;
+        DS1820_SnapshotRow Rows[];
+    } DS1820_SnapshotTable;
+
+    /* Writer side */
+    DS1820_SnapshotTable *DS1820_SnapshotInit(void *pMemory, uint32_t iRows);
+    DS1820_State DS1820_SnapshotPublish(DS1820_SnapshotTable *Table, uint64_t iAddress, uint32_t iTime, int iTemp);
+    void DS1820_SnapshotSink(int iDevice, uint32_t iTime, int iTemp);
+
+    /* Reader side */
+    DS1820_SnapshotTable *DS1820_SnapshotOpen(void *pMemory);
+    DS1820_State DS1820_SnapshotRead(const DS1820_SnapshotTable *Table, uint64_t iAddress, DS1820_SnapshotRow *Row);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DS1820_SNAPSHOT_H */
+
@@ -0,0 +1,264 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Stats.c
+ * @author  Vojtech Vigner
+ * @brief   Incremental per device statistics over tumbling time windows and 
+ *          sliding sample windows (minimum, maximum, mean, variance).
+ * 
+ * @attention   
+ *          Every update is O(1) per window. Each device has up to 
+ *          DS1820_STATS_PERIODS tumbling windows of different periods, they 
+ *          use Welford algorithm for mean and variance. Tumbling window is 
+ *          closed by the first sample after its period or by 
+ *          DS1820_StatsFlush, so a device which stopped sending still gets
+ *          its last summary. Sliding window of last DS1820_STATS_WINDOW 
+ *          samples keeps exact integer sums for mean and variance and 
+ *          monotonic deques for minimum and maximum.
+ * 
+ * @verbatim
+ *          ********************************************************************
+ *                                How to use this module
+ *          ********************************************************************
+ *          1. Set tumbling window periods and summary consumer by 
+ *          DS1820_StatsInit, e.g. 60000 and 3600000 ms for per-minute and
+ *          per-hour summaries.
+ * 
+ *          2. Register DS1820_StatsSink by DS1820_SampleSinkAdd or feed 
+ *          samples by DS1820_StatsUpdate.
+ *
+ *          3. Call DS1820_StatsFlush periodically, e.g. once per the shortest
+ *          period, to close windows of silent devices.
+ *
+ *          4. Closed tumbling windows are passed to the consumer, sliding 
+ *          window can be read any time by DS1820_StatsSliding.
+ *  @endverbatim  
+ *******************************************************************************
+ */
+#include <string.h>
+#include "DS1820_Stats.h"
+
+#if (DS1820_STATS_WINDOW & (DS1820_STATS_WINDOW - 1))
+#error "DS1820_STATS_WINDOW has to be power of two"
+#endif
+
+#define WINDOW_MASK     (DS1820_STATS_WINDOW - 1)
+
+/* Tumbling window state */
+typedef struct _DS1820_Tumbling {
+    uint32_t iStart;
+    uint32_t iCount;
+    int16_t iMin;
+    int16_t iMax;
+    float fMean;
+    float fM2;
+} DS1820_Tumbling;
+
+/* Sliding window state, deques hold sample positions */
+typedef struct _DS1820_Sliding {
+    int16_t Samples[DS1820_STATS_WINDOW];
+    uint32_t Times[DS1820_STATS_WINDOW];
+    uint32_t MinDeque[DS1820_STATS_WINDOW];
+    uint32_t MaxDeque[DS1820_STATS_WINDOW];
+    uint32_t iMinHead, iMinTail;
+    uint32_t iMaxHead, iMaxTail;
+    uint32_t iPosition;
+    int32_t iSum;
+    int64_t iSquares;
+} DS1820_Sliding;
+
+typedef struct _DS1820_DeviceStats {
+    DS1820_Tumbling Tumbling[DS1820_STATS_PERIODS];
+    DS1820_Sliding Sliding;
+} DS1820_DeviceStats;
+
+static DS1820_DeviceStats Stats[DS1820_MAX_DEVICES];
+static uint32_t WindowPeriods[DS1820_STATS_PERIODS] = {60000};
+static int iWindowCount = 1;
+static DS1820_SummarySink SummarySink = 0;
+
+/* Internal functions */
+static void TumblingUpdate(int iDevice, DS1820_Tumbling *Window, uint32_t iPeriod, uint32_t iTime, int iTemp);
+static void TumblingClose(int iDevice, DS1820_Tumbling *Window, uint32_t iPeriod);
+static void SlidingUpdate(DS1820_Sliding *Window, uint32_t iTime, int iTemp);
+
+/**
+ * Clears statistics of all devices and sets tumbling windows.
+ * @param Periods Tumbling window lengths in tick units (see DS1820_TickSet).
+ * @param iPeriods Number of tumbling windows, at most DS1820_STATS_PERIODS.
+ * @param Sink Summary consumer, can be NULL.
+ * @return DS1820_OK if successfull, DS1820_ERROR if there are too many 
+ * windows.
+ */
+DS1820_State DS1820_StatsInit(const uint32_t *Periods, int iPeriods, DS1820_SummarySink Sink) {
+    int i;
+
+    if ((iPeriods < 0) || (iPeriods > DS1820_STATS_PERIODS)) return DS1820_ERROR;
+
+    memset(Stats, 0, sizeof (Stats));
+    for (i = 0; i < iPeriods; i++) WindowPeriods[i] = Periods[i];
+    iWindowCount = iPeriods;
+    SummarySink = Sink;
+
+    return DS1820_OK;
+}
+
+/**
+ * Adds sample into windows of device.
+ * @param iDevice Device handle.
+ * @param iTime Sample timestamp.
+ * @param iTemp Temperature in degrees of Celsius * 10.
+ */
+void DS1820_StatsUpdate(int iDevice, uint32_t iTime, int iTemp) {
+    int i;
+
+    if ((iDevice < 0) || (iDevice >= DS1820_MAX_DEVICES)) return;
+
+    for (i = 0; i < iWindowCount; i++)
+        TumblingUpdate(iDevice, &Stats[iDevice].Tumbling[i], WindowPeriods[i], iTime, iTemp);
+    SlidingUpdate(&Stats[iDevice].Sliding, iTime, iTemp);
+}
+
+/**
+ * Read engine consumer, see DS1820_SampleSinkAdd.
+ * @param iDevice Device handle.
+ * @param iTime Sample timestamp.
+ * @param iTemp Temperature in degrees of Celsius * 10.
+ */
+void DS1820_StatsSink(int iDevice, uint32_t iTime, int iTemp) {
+    DS1820_StatsUpdate(iDevice, iTime, iTemp);
+}
+
+/**
+ * Closes tumbling windows whose period ended and passes their summaries to 
+ * the consumer, windows of devices which stopped sending are closed too.
+ * @param iNow Current time in tick units.
+ */
+void DS1820_StatsFlush(uint32_t iNow) {
+    DS1820_Tumbling *Window;
+    int i, w;
+
+    for (i = 0; i < DS1820_MAX_DEVICES; i++)
+        for (w = 0; w < iWindowCount; w++) {
+            Window = &Stats[i].Tumbling[w];
+            if ((Window->iCount) && (iNow - Window->iStart >= WindowPeriods[w]))
+                TumblingClose(i, Window, WindowPeriods[w]);
+        }
+}
+
+/**
+ * Returns summary of last DS1820_STATS_WINDOW samples of device.
+ * @param iDevice Device handle.
+ * @param Summary Summary output, iStart is timestamp of the oldest sample.
+ * @return DS1820_OK if successfull, DS1820_ERROR if there are no samples.
+ */
+DS1820_State DS1820_StatsSliding(int iDevice, DS1820_Summary *Summary) {
+    DS1820_Sliding *Window;
+    uint32_t iCount;
+
+    if ((iDevice < 0) || (iDevice >= DS1820_MAX_DEVICES)) return DS1820_ERROR;
+
+    Window = &Stats[iDevice].Sliding;
+    iCount = (Window->iPosition < DS1820_STATS_WINDOW) ? Window->iPosition : DS1820_STATS_WINDOW;
+
+    if (iCount == 0) return DS1820_ERROR;
+
+    Summary->iStart = Window->Times[(Window->iPosition - iCount) & WINDOW_MASK];
+    Summary->iPeriod = 0;
+    Summary->iCount = iCount;
+    Summary->iMin = Window->Samples[Window->MinDeque[Window->iMinHead & WINDOW_MASK] & WINDOW_MASK];
+    Summary->iMax = Window->Samples[Window->MaxDeque[Window->iMaxHead & WINDOW_MASK] & WINDOW_MASK];
+    Summary->fMean = (float) Window->iSum / iCount;
+
+    /* Exact integer numerator, no cancellation */
+    Summary->fVariance = (float) ((int64_t) iCount * Window->iSquares - (int64_t) Window->iSum * Window->iSum) /
+            ((float) iCount * iCount);
+
+    return DS1820_OK;
+}
+
+/**
+ * Updates tumbling window, closes it when the sample belongs to the next 
+ * window.
+ */
+void TumblingUpdate(int iDevice, DS1820_Tumbling *Window, uint32_t iPeriod, uint32_t iTime, int iTemp) {
+    float fDelta;
+
+    if ((Window->iCount) && (iTime - Window->iStart >= iPeriod)) TumblingClose(iDevice, Window, iPeriod);
+
+    if (Window->iCount == 0) {
+        /* Align windows to period boundaries */
+        Window->iStart = (iPeriod) ? iTime - iTime % iPeriod : iTime;
+        Window->iMin = (int16_t) iTemp;
+        Window->iMax = (int16_t) iTemp;
+        Window->fMean = 0;
+        Window->fM2 = 0;
+    }
+
+    if (iTemp < Window->iMin) Window->iMin = (int16_t) iTemp;
+    if (iTemp > Window->iMax) Window->iMax = (int16_t) iTemp;
+
+    /* Welford */
+    Window->iCount++;
+    fDelta = iTemp - Window->fMean;
+    Window->fMean += fDelta / Window->iCount;
+    Window->fM2 += fDelta * (iTemp - Window->fMean);
+}
+
+/**
+ * Passes summary of tumbling window to the consumer and empties the window.
+ */
+void TumblingClose(int iDevice, DS1820_Tumbling *Window, uint32_t iPeriod) {
+    DS1820_Summary Summary;
+
+    Summary.iStart = Window->iStart;
+    Summary.iPeriod = iPeriod;
+    Summary.iCount = Window->iCount;
+    Summary.iMin = Window->iMin;
+    Summary.iMax = Window->iMax;
+    Summary.fMean = Window->fMean;
+    Summary.fVariance = (Window->iCount > 1) ? Window->fM2 / Window->iCount : 0;
+
+    if (SummarySink) SummarySink(iDevice, &Summary);
+
+    Window->iCount = 0;
+}
+
+/**
+ * Updates sliding window. Deques keep positions of samples which can still 
+ * become minimum (maximum), values are increasing (decreasing) from head.
+ */
+void SlidingUpdate(DS1820_Sliding *Window, uint32_t iTime, int iTemp) {
+    uint32_t iPosition = Window->iPosition;
+    uint32_t iOldest;
+    int16_t iOld;
+
+    /* Remove the oldest sample */
+    if (iPosition >= DS1820_STATS_WINDOW) {
+        iOldest = iPosition - DS1820_STATS_WINDOW;
+        iOld = Window->Samples[iOldest & WINDOW_MASK];
+
+        Window->iSum -= iOld;
+        Window->iSquares -= (int32_t) iOld * iOld;
+
+        if (Window->MinDeque[Window->iMinHead & WINDOW_MASK] == iOldest) Window->iMinHead++;
+        if (Window->MaxDeque[Window->iMaxHead & WINDOW_MASK] == iOldest) Window->iMaxHead++;
+    }
+
+    Window->Samples[iPosition & WINDOW_MASK] = (int16_t) iTemp;
+    Window->Times[iPosition & WINDOW_MASK] = iTime;
+    Window->iSum += iTemp;
+    Window->iSquares += (int32_t) iTemp * iTemp;
+
+    /* Drop samples which can not be minimum or maximum anymore */
+    while ((Window->iMinTail != Window->iMinHead) &&
+            (Window->Samples[Window->MinDeque[(Window->iMinTail - 1) & WINDOW_MASK] & WINDOW_MASK] >= iTemp))
+        Window->iMinTail--;
+    Window->MinDeque[Window->iMinTail++ & WINDOW_MASK] = iPosition;
+
+    while ((Window->iMaxTail != Window->iMaxHead) &&
+            (Window->Samples[Window->MaxDeque[(Window->iMaxTail - 1) & WINDOW_MASK] & WINDOW_MASK] <= iTemp))
+        Window->iMaxTail--;
+    Window->MaxDeque[Window->iMaxTail++ & WINDOW_MASK] = iPosition;
+
+    Window->iPosition++;
+}
@@ -0,0 +1,63 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Stats.h
+ * @author  Vojtech Vigner
+ * @brief   Incremental per device statistics over tumbling time windows and 
+ *          sliding sample windows (minimum, maximum, mean, variance).
+ *          
+ * @see     DS1820_Stats.c documentation
+ *******************************************************************************
+ */
+
+#ifndef DS1820_STATS_H
+#define	DS1820_STATS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "DS1820.h"
+
+    /* Maximum number of tumbling windows per device, e.g. minute and hour */
+#ifndef DS1820_STATS_PERIODS
+#define DS1820_STATS_PERIODS    2
+#endif
+
+    /* Sliding window length in samples */
+#ifndef DS1820_STATS_WINDOW
+#define DS1820_STATS_WINDOW     16
+#endif
+
+    /* Window summary, temperatures in degrees of Celsius * 10, period of 
+     * tumbling window or 0 for sliding window */
+    typedef struct _DS1820_Summary {
+        uint32_t iStart;
+        uint32_t iPeriod;
+        uint32_t iCount;
+        int16_t iMin;
+        int16_t iMax;
+        float fMean;
+        float fVariance;
+    } DS1820_Summary;
+
+    /* Summary consumer, called when tumbling window of device is closed */
+    typedef void (*DS1820_SummarySink)(int iDevice, const DS1820_Summary *Summary);
+
+    /* Configuration */
+    DS1820_State DS1820_StatsInit(const uint32_t *Periods, int iPeriods, DS1820_SummarySink Sink);
+
+    /* Update */
+    void DS1820_StatsUpdate(int iDevice, uint32_t iTime, int iTemp);
+    void DS1820_StatsSink(int iDevice, uint32_t iTime, int iTemp);
+    void DS1820_StatsFlush(uint32_t iNow);
+
+    /* Results */
+    DS1820_State DS1820_StatsSliding(int iDevice, DS1820_Summary *Summary);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DS1820_STATS_H */
+
@@ -0,0 +1,83 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Trace.c
+ * @author  Vojtech Vigner
+ * @brief   Low overhead binary tracing of DS1820 bus transaction phases into 
+ *          a ring buffer. Compiled in only if DS1820_TRACE_ENABLE is defined.
+ * 
+ * @attention   
+ *          DS1820.c records begin and end event of every transaction phase 
+ *          (ROM match, scratchpad read, ...) with device handle and result.
+ *          The ring keeps the last DS1820_TRACE_SIZE events, older events are
+ *          overwritten. Without DS1820_TRACE_ENABLE the hooks are empty macros
+ *          and this file is not needed.
+ * 
+ * @verbatim
+ *          ********************************************************************
+ *                                How to use this module
+ *          ********************************************************************
+ *          1. Define DS1820_TRACE_ENABLE for DS1820.c and this file, 
+ *          optionally define DS1820_TRACE_TIME for finer timestamps.
+ * 
+ *          2. Copy events by DS1820_TraceRead and store them as binary file
+ *          (or dump the buffer by a debugger).
+ *
+ *          3. Convert the file on the host by tools/DS1820_TraceJson into 
+ *          Chrome trace / Perfetto JSON.
+ *  @endverbatim  
+ *******************************************************************************
+ */
+#include "DS1820_Trace.h"
+
+#ifdef DS1820_TRACE_ENABLE
+
+#if (DS1820_TRACE_SIZE & (DS1820_TRACE_SIZE - 1))
+#error "DS1820_TRACE_SIZE has to be power of two"
+#endif
+
+#define TRACE_MASK  (DS1820_TRACE_SIZE - 1)
+
+static DS1820_TraceEvent Events[DS1820_TRACE_SIZE];
+static uint32_t iHead = 0;
+
+/**
+ * Records one event, called by DS1820.c hooks.
+ * @param iPhase Transaction phase, DS1820_TRACE_END flag for phase end.
+ * @param iHandle Device handle, -1 for all or unknown device.
+ * @param iResult Phase result, 0 if successfull.
+ */
+void DS1820_TraceRecord(uint8_t iPhase, int iHandle, uint8_t iResult) {
+    DS1820_TraceEvent *Event = &Events[iHead++ & TRACE_MASK];
+
+    Event->iTime = DS1820_TRACE_TIME();
+    Event->iHandle = (int16_t) iHandle;
+    Event->iPhase = iPhase;
+    Event->iResult = iResult;
+}
+
+/**
+ * Copies recorded events, the oldest first.
+ * @param Output Output array.
+ * @param iMax Output array length.
+ * @return Number of copied events.
+ */
+int DS1820_TraceRead(DS1820_TraceEvent *Output, int iMax) {
+    uint32_t iCount = (iHead < DS1820_TRACE_SIZE) ? iHead : DS1820_TRACE_SIZE;
+    uint32_t i;
+
+    if ((uint32_t) iMax < iCount) iCount = (uint32_t) iMax;
+
+    for (i = 0; i < iCount; i++)
+        Output[i] = Events[(iHead - iCount + i) & TRACE_MASK];
+
+    return (int) iCount;
+}
+
+/**
+ * Drops all recorded events.
+ */
+void DS1820_TraceClear(void) {
+    iHead = 0;
+}
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_Trace.h
+ * @author  Vojtech Vigner
+ * @brief   Low overhead binary tracing of DS1820 bus transaction phases into 
+ *          a ring buffer. Compiled in only if DS1820_TRACE_ENABLE is defined.
+ *          
+ * @see     DS1820_Trace.c documentation
+ *******************************************************************************
+ */
+
+#ifndef DS1820_TRACE_H
+#define	DS1820_TRACE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "DS1820.h"
+
+    /* Number of events kept, has to be power of two */
+#ifndef DS1820_TRACE_SIZE
+#define DS1820_TRACE_SIZE       256
+#endif
+
+    /* Event timestamp source, e.g. cycle counter for better resolution */
+#ifndef DS1820_TRACE_TIME
+#define DS1820_TRACE_TIME()     DS1820_TickGet()
+#endif
+
+    /* Event phase flag, set for phase end */
+#define DS1820_TRACE_END        0x80
+
+    /* Transaction phases */
+    typedef enum _DS1820_TracePhase {
+        DS1820_TRACE_MATCH = 1,
+        DS1820_TRACE_READ = 2,
+        DS1820_TRACE_WRITE = 3,
+        DS1820_TRACE_CONVERT = 4,
+        DS1820_TRACE_STORE = 5,
+        DS1820_TRACE_RECALL = 6,
+        DS1820_TRACE_POWER = 7,
+        DS1820_TRACE_SEARCH = 8,
+        DS1820_TRACE_RETRY = 9
+    } DS1820_TracePhase;
+
+    /* Fixed size event, 12 bytes, little endian when dumped from the target */
+    typedef struct _DS1820_TraceEvent {
+        uint32_t iTime;
+        int16_t iHandle;
+        uint8_t iPhase;
+        uint8_t iResult;
+        uint8_t Reserved[4];
+    } DS1820_TraceEvent;
+
+    /* Recording */
+    void DS1820_TraceRecord(uint8_t iPhase, int iHandle, uint8_t iResult);
+
+    /* Reading */
+    int DS1820_TraceRead(DS1820_TraceEvent *Events, int iMax);
+    void DS1820_TraceClear(void);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DS1820_TRACE_H */
+
@@ -11,7 +11,8 @@
 #include "DS1820.h"
 
 #define MAX_DEVICES 	8
-#define MAX_RETRIES 2
+
+static int Temperature[MAX_DEVICES];
 
 static void Delay(int iMiliSecons) {
     /* Some code */
@@ -21,14 +22,23 @@ static void LEDToggle(void) {
     /* Some code */
 };
 
+/* Read engine consumer, device handle is the position found by search */
+static void TemperatureStore(int iDevice, uint32_t iTime, int iTemp) {
+    /* Timestamp is not needed, readings are printed right after the pass */
+    (void) iTime;
+
+    if (iDevice < MAX_DEVICES) Temperature[iDevice] = iTemp;
+}
+
 int main(void) {
 
     int i;
-    int iRetry;
+    int iDevCount;
     uint64_t Address[MAX_DEVICES];
 
     /* Initialize DS1820 */
     DS1820_Init();
+    DS1820_SampleSinkAdd(TemperatureStore);
 
     /* Search for devices */
     do {
@@ -46,18 +56,14 @@ int main(void) {
         /* A necessary delay for conversion, @ref DS1820 datasheet */
         Delay(750);
         
-        /* Read the temperature value from all devices respectively 
+        /* Read the temperature value from all devices
          * 
-         * The number of maximum retries is in the MAX_RETRIES constant,
-         * this is useful for a long cable connection or if the signal is jammed.
+         * Failed readings are retried by the library at the end of the pass
+         * according to the retry policy, see DS1820_RetryPolicySet. This is 
+         * useful for a long cable connection or if the signal is jammed.
          */
-        for (i = 0; i < iDevCount; i++) {
-            iRetry = 0;
-            do {
-                Temperature[i] = DS1820_TemperatureGet(Address[i]);
-                iRetry++;
-            } while ((Temperature[i] == DS1820_TEMP_ERROR) && (iRetry < MAX_RETRIES));
-        }
+        for (i = 0; i < iDevCount; i++) Temperature[i] = DS1820_TEMP_ERROR;
+        DS1820_TemperatureReadAll();
 
         /* Print temperatures */
         for (i = 0; i < iDevCount; i++) {
@@ -0,0 +1,155 @@
+/**
+ *******************************************************************************
+ * @file    OneWire.h
+ * @author  Vojtech Vigner
+ * @brief   Host OneWire backends for DS1820 library. The OneWire API used by
+ *          DS1820.c is implemented by a discrete-event bus simulator running
+ *          in virtual time (OneWire_Sim.c) or by replay of bus operations 
+ *          captured by DS1820_Capture.c (OneWire_Replay.c), link one of them.
+ *          
+ * @see     OneWire_Sim.c and OneWire_Replay.c documentation
+ *******************************************************************************
+ */
+
+#ifndef ONEWIRE_H
+#define	ONEWIRE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "stdint.h"
+
+    /* OneWire results */
+#define OW_OK               0
+#define OW_NO_DEV           1
+
+    /* Bus speeds */
+#define OW_SPEED_STANDARD   0
+#define OW_SPEED_OVERDRIVE  1
+
+    /* Modeled standard speed timing in microseconds */
+#ifndef OW_SIM_RESET_TIME
+#define OW_SIM_RESET_TIME       960
+#endif
+#ifndef OW_SIM_SLOT_TIME
+#define OW_SIM_SLOT_TIME        70
+#endif
+
+    /* Modeled overdrive speed timing in microseconds */
+#ifndef OW_SIM_RESET_TIME_OD
+#define OW_SIM_RESET_TIME_OD    100
+#endif
+#ifndef OW_SIM_SLOT_TIME_OD
+#define OW_SIM_SLOT_TIME_OD     10
+#endif
+
+    /* Default device timing in microseconds */
+#ifndef OW_SIM_CONVERSION_TIME
+#define OW_SIM_CONVERSION_TIME  500000
+#endif
+#ifndef OW_SIM_COPY_TIME
+#define OW_SIM_COPY_TIME        10000
+#endif
+
+    /* Parasite device current during conversion and default pull-up 
+     * capabilities in microamperes */
+#ifndef OW_SIM_CONVERSION_CURRENT
+#define OW_SIM_CONVERSION_CURRENT   1000
+#endif
+#ifndef OW_SIM_WEAK_SUPPLY
+#define OW_SIM_WEAK_SUPPLY          500
+#endif
+#ifndef OW_SIM_STRONG_SUPPLY
+#define OW_SIM_STRONG_SUPPLY        20000
+#endif
+
+    /* Simulator statistics, times in microseconds, brown-outs include 
+     * injected ones */
+    typedef struct _OW_SimStats {
+        uint64_t iBusyTime;
+        uint64_t iStrongTime;
+        uint32_t iResets;
+        uint32_t iBytesWritten;
+        uint32_t iBytesRead;
+        uint32_t iSearches;
+        uint32_t iConversions;
+        uint32_t iBrownOuts;
+        uint32_t iBitErrors;
+        uint32_t iPresenceLost;
+        uint32_t iDrops;
+        uint32_t iShorts;
+        uint32_t iCorruptReads;
+    } OW_SimStats;
+
+    /* Fault probabilities in parts per million, see OW_SimFaultsSet */
+#define OW_SIM_PPM                  1000000
+
+    typedef struct _OW_SimFaults {
+        uint32_t iBitError;
+        uint32_t iNoPresence;
+        uint32_t iDrop;
+        uint32_t iShort;
+        uint32_t iBrownOut;
+    } OW_SimFaults;
+
+    /* Replay statistics, bus time is modeled from replayed calls in 
+     * microseconds, records left are not taken yet */
+    typedef struct _OW_ReplayStats {
+        uint64_t iBusyTime;
+        uint32_t iCalls;
+        uint32_t iRecords;
+        uint32_t iMismatches;
+        uint32_t iSkipped;
+        uint32_t iLeft;
+    } OW_ReplayStats;
+
+    /* OneWire API used by DS1820.c */
+    void OW_Init(void);
+    uint8_t OW_Reset(void);
+    uint8_t OW_ROMMatch(uint64_t iAddress);
+    void OW_ByteWrite(uint8_t iByte);
+    uint8_t OW_ByteRead(void);
+    uint8_t OW_CRCCalculate(uint8_t iCRC, uint8_t iByte);
+    void OW_WeakPullUp(void);
+    void OW_StrongPullUp(void);
+    uint64_t OW_SearchFirst(uint8_t iFamily);
+    uint64_t OW_SearchNext(void);
+    void OW_SpeedSet(uint8_t iSpeed);
+
+    /* Simulated devices */
+    void OW_SimClear(void);
+    uint64_t OW_SimAddress(uint8_t iFamily, uint64_t iSerial);
+    int OW_SimDeviceAdd(uint64_t iAddress, uint8_t bParasite);
+    void OW_SimTemperatureSet(int iDevice, int iTemp);
+    void OW_SimConversionTimeSet(int iDevice, uint32_t iMicroSeconds);
+    void OW_SimOverdriveSet(int iDevice, uint8_t bOverdrive);
+    void OW_SimSupplySet(uint32_t iWeak, uint32_t iStrong);
+    int OW_SimSelected(void);
+
+    /* Fault injection */
+    void OW_SimFaultsSet(const OW_SimFaults *Faults, uint64_t iSeed);
+    void OW_SimShortClear(void);
+
+    /* Virtual time */
+    uint64_t OW_SimTime(void);
+    void OW_SimAdvance(uint64_t iMicroSeconds);
+    uint32_t OW_SimTick(void);
+    void OW_SimDelay(int iMiliSeconds);
+
+    /* Statistics */
+    void OW_SimStatsGet(OW_SimStats *Stats);
+
+    /* Replay of captured bus operations */
+    int OW_ReplayLoad(const uint8_t *Data, int iLength);
+    uint32_t OW_ReplayTick(void);
+    void OW_ReplayDelay(int iMiliSeconds);
+    void OW_ReplayStatsGet(OW_ReplayStats *Stats);
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* ONEWIRE_H */
+
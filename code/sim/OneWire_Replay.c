@@ -0,0 +1,393 @@
+/**
+ *******************************************************************************
+ * @file    OneWire_Replay.c
+ * @author  Vojtech Vigner
+ * @brief   Host OneWire backend replaying bus operations captured by
+ *          DS1820_Capture.c. Implements the OneWire API used by DS1820.c.
+ *
+ * @attention
+ *          Every OneWire call takes the next captured record and returns the
+ *          captured result (presence, read byte, found address). Replay time
+ *          is the captured time of the last taken record, delays do not wait,
+ *          so a session replays faster than real time and always gives the
+ *          same results. A call which does not fit the next record (driver
+ *          version doing different operations) is counted as mismatch and
+ *          answered as if no device was present. Mismatching reset, ROM match
+ *          and search start skip forward to the next fitting record, so the
+ *          replay continues with the next transaction, mismatching written
+ *          byte takes the record. Bus time is modeled from the calls with the
+ *          timing of the simulator, not taken from the capture, so driver
+ *          versions can be compared by it. The capture holds only search
+ *          results, search ending without device takes no bus time, so a
+ *          search broken by a fault is modeled shorter than it was.
+ *
+ * @verbatim
+ *          ********************************************************************
+ *                                How to use this module
+ *          ********************************************************************
+ *          1. Build DS1820.c with code/sim in include path and link this file
+ *          instead of the OneWire library.
+ *
+ *          2. Load captured session by OW_ReplayLoad, the data has to stay
+ *          valid during replay.
+ *
+ *          3. Register OW_ReplayTick and OW_ReplayDelay by DS1820_TickSet and
+ *          DS1820_DelaySet and run the same DS1820 calls as the captured
+ *          application.
+ *
+ *          4. Read modeled bus time and mismatches by OW_ReplayStatsGet.
+ *  @endverbatim
+ *******************************************************************************
+ */
+#include "OneWire.h"
+#include "DS1820_Capture.h"
+
+/* Decoded capture record */
+typedef struct _OW_ReplayRecord {
+    uint8_t iOp;
+    uint8_t iByte;
+    uint32_t iDelta;
+    uint64_t iAddress;
+} OW_ReplayRecord;
+
+/* Captured session */
+static const uint8_t *Capture = 0;
+static int iCaptureLength = 0;
+static int iPosition = 0;
+
+/* Replay state */
+static uint32_t iTime = 0;
+static uint8_t iSpeed = OW_SPEED_STANDARD;
+static OW_ReplayStats Stats;
+
+/* Internal functions */
+static int RecordDecode(int iAt, OW_ReplayRecord *Record);
+static uint8_t RecordTake(uint8_t iOp, uint8_t iByte, uint64_t iAddress, OW_ReplayRecord *Record);
+static uint8_t RecordFits(const OW_ReplayRecord *Record, uint8_t iOp, uint8_t iByte, uint64_t iAddress);
+static void BusTime(uint32_t iResets, uint32_t iSlots);
+
+/**
+ * Initializes the bus.
+ */
+void OW_Init(void) {
+    iSpeed = OW_SPEED_STANDARD;
+}
+
+/**
+ * Replays reset.
+ * @return Captured presence result, OW_NO_DEV on mismatch.
+ */
+uint8_t OW_Reset(void) {
+    OW_ReplayRecord Record;
+
+    BusTime(1, 0);
+
+    return RecordTake(DS1820_CAPTURE_RESET, 0, 0, &Record) ? Record.iByte : OW_NO_DEV;
+}
+
+/**
+ * Replays reset with Match ROM or Skip ROM.
+ * @param iAddress 64bit device address, 0 for Skip ROM.
+ * @return Captured presence result, OW_NO_DEV on mismatch.
+ */
+uint8_t OW_ROMMatch(uint64_t iAddress) {
+    OW_ReplayRecord Record;
+    uint8_t iResult;
+
+    if (iAddress == 0) iResult = RecordTake(DS1820_CAPTURE_SKIP, 0, 0, &Record) ? Record.iByte : OW_NO_DEV;
+    else iResult = RecordTake(DS1820_CAPTURE_MATCH, 0, iAddress, &Record) ? Record.iByte : OW_NO_DEV;
+
+    /* ROM command is not sent without presence */
+    BusTime(1, (iResult != OW_OK) ? 0 : (iAddress) ? 72 : 8);
+
+    return iResult;
+}
+
+/**
+ * Replays written byte.
+ * @param iByte Byte to be written, compared with the captured one.
+ */
+void OW_ByteWrite(uint8_t iByte) {
+    OW_ReplayRecord Record;
+
+    BusTime(0, 8);
+    RecordTake(DS1820_CAPTURE_WRITE, iByte, 0, &Record);
+}
+
+/**
+ * Replays read byte.
+ * @return Captured byte, 0xFF on mismatch.
+ */
+uint8_t OW_ByteRead(void) {
+    OW_ReplayRecord Record;
+
+    BusTime(0, 8);
+
+    return RecordTake(DS1820_CAPTURE_READ, 0, 0, &Record) ? Record.iByte : 0xFF;
+}
+
+/**
+ * Dallas CRC8 of one byte.
+ * @param iCRC CRC of previous bytes.
+ * @param iByte Next byte.
+ * @return New CRC.
+ */
+uint8_t OW_CRCCalculate(uint8_t iCRC, uint8_t iByte) {
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        iCRC = ((iCRC ^ iByte) & 0x01) ? (uint8_t) ((iCRC >> 1) ^ 0x8C) : (uint8_t) (iCRC >> 1);
+        iByte >>= 1;
+    }
+
+    return iCRC;
+}
+
+/**
+ * Replays end of strong pull-up.
+ */
+void OW_WeakPullUp(void) {
+    OW_ReplayRecord Record;
+
+    RecordTake(DS1820_CAPTURE_WEAK, 0, 0, &Record);
+}
+
+/**
+ * Replays start of strong pull-up.
+ */
+void OW_StrongPullUp(void) {
+    OW_ReplayRecord Record;
+
+    RecordTake(DS1820_CAPTURE_STRONG, 0, 0, &Record);
+}
+
+/**
+ * Replays search start.
+ * @param iFamily Family code of searched devices, 0 for all devices.
+ * @return Captured address, 0 on mismatch.
+ */
+uint64_t OW_SearchFirst(uint8_t iFamily) {
+    OW_ReplayRecord Record;
+
+    BusTime(1, 8 + 3 * 64);
+
+    return RecordTake(DS1820_CAPTURE_SEARCH_FIRST, iFamily, 0, &Record) ? Record.iAddress : 0;
+}
+
+/**
+ * Replays search step, only steps finding device take bus time.
+ * @return Captured address, 0 on mismatch.
+ */
+uint64_t OW_SearchNext(void) {
+    OW_ReplayRecord Record;
+
+    if (!RecordTake(DS1820_CAPTURE_SEARCH_NEXT, 0, 0, &Record)) return 0;
+
+    /* Search ending after the last device does not use the bus */
+    if (Record.iAddress) BusTime(1, 8 + 3 * 64);
+
+    return Record.iAddress;
+}
+
+/**
+ * Sets bus speed, used for bus time.
+ * @param iNewSpeed OW_SPEED_STANDARD or OW_SPEED_OVERDRIVE.
+ */
+void OW_SpeedSet(uint8_t iNewSpeed) {
+    OW_ReplayRecord Record;
+
+    iSpeed = iNewSpeed;
+    RecordTake(DS1820_CAPTURE_SPEED, iNewSpeed, 0, &Record);
+}
+
+/**
+ * Loads captured session and restarts replay.
+ * @param Data Records written by DS1820_CaptureSet writer.
+ * @param iLength Data length in bytes.
+ * @return 0 if successfull, -1 if data do not start with start record of
+ * supported version.
+ */
+int OW_ReplayLoad(const uint8_t *Data, int iLength) {
+    OW_ReplayStats Empty = {0};
+    OW_ReplayRecord Record;
+
+    Capture = Data;
+    iCaptureLength = iLength;
+    iTime = 0;
+    iSpeed = OW_SPEED_STANDARD;
+    Stats = Empty;
+
+    iPosition = RecordDecode(0, &Record);
+    if ((iPosition == 0) || (Record.iOp != DS1820_CAPTURE_START) || (Record.iByte != DS1820_CAPTURE_VERSION)) {
+        iCaptureLength = 0;
+        iPosition = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Replay tick, see DS1820_TickSet.
+ * @return Captured time of the last taken record since capture start, in
+ * DS1820_CAPTURE_TIME units.
+ */
+uint32_t OW_ReplayTick(void) {
+    return iTime;
+}
+
+/**
+ * Replay delay, see DS1820_DelaySet. Does not wait, captured time already
+ * includes delays.
+ * @param iMiliSeconds Delay.
+ */
+void OW_ReplayDelay(int iMiliSeconds) {
+    (void) iMiliSeconds;
+}
+
+/**
+ * Returns replay statistics.
+ * @param Output Statistics output.
+ */
+void OW_ReplayStatsGet(OW_ReplayStats *Output) {
+    OW_ReplayRecord Record;
+    int iAt = iPosition, iNext;
+
+    *Output = Stats;
+    Output->iLeft = 0;
+
+    while ((iNext = RecordDecode(iAt, &Record)) != 0) {
+        if (Record.iOp != DS1820_CAPTURE_START) Output->iLeft++;
+        iAt = iNext;
+    }
+}
+
+/**
+ * Decodes one record.
+ * @param iAt Record position in captured data.
+ * @param Record Decoded record output.
+ * @return Position of the next record, 0 at the end of data or if record is
+ * truncated or unknown.
+ */
+int RecordDecode(int iAt, OW_ReplayRecord *Record) {
+    int i, iShift = 0;
+
+    if (iAt >= iCaptureLength) return 0;
+
+    Record->iOp = Capture[iAt++];
+    Record->iDelta = 0;
+    Record->iByte = 0;
+    Record->iAddress = 0;
+    if (Record->iOp > DS1820_CAPTURE_SPEED) return 0;
+
+    /* Time delta, 7 bits per byte, the lowest first */
+    do {
+        if ((iAt >= iCaptureLength) || (iShift > 28)) return 0;
+        Record->iDelta |= (uint32_t) (Capture[iAt] & 0x7F) << iShift;
+        iShift += 7;
+    } while (Capture[iAt++] & 0x80);
+
+    if ((Record->iOp != DS1820_CAPTURE_WEAK) && (Record->iOp != DS1820_CAPTURE_STRONG) &&
+            (Record->iOp != DS1820_CAPTURE_SEARCH_NEXT)) {
+        if (iAt >= iCaptureLength) return 0;
+        Record->iByte = Capture[iAt++];
+    }
+
+    if ((Record->iOp == DS1820_CAPTURE_MATCH) || (Record->iOp == DS1820_CAPTURE_SEARCH_FIRST) ||
+            (Record->iOp == DS1820_CAPTURE_SEARCH_NEXT)) {
+        if (iAt + 8 > iCaptureLength) return 0;
+        for (i = 0; i < 8; i++) Record->iAddress |= (uint64_t) Capture[iAt++] << (8 * i);
+    }
+
+    return iAt;
+}
+
+/**
+ * Takes the next record if it fits the call. Mismatching transaction start
+ * skips forward to the next fitting record.
+ * @param iOp Called operation, DS1820_CaptureOp.
+ * @param iByte Written byte, family code or speed of the call.
+ * @param iAddress Matched address of the call.
+ * @param Record Taken record output.
+ * @return 1 if record was taken, 0 if not.
+ */
+uint8_t RecordTake(uint8_t iOp, uint8_t iByte, uint64_t iAddress, OW_ReplayRecord *Record) {
+    int iAt = iPosition, iNext;
+    uint32_t iDelta = 0, iSkipped = 0;
+
+    Stats.iCalls++;
+
+    /* Restarted capture continues the same session */
+    while (((iNext = RecordDecode(iAt, Record)) != 0) && (Record->iOp == DS1820_CAPTURE_START)) {
+        iDelta += Record->iDelta;
+        iAt = iNext;
+    }
+
+    /* Different written byte takes the record, the driver output may differ */
+    if ((iNext) && (Record->iOp == iOp) && ((iOp == DS1820_CAPTURE_WRITE) || RecordFits(Record, iOp, iByte, iAddress))) {
+        if (!RecordFits(Record, iOp, iByte, iAddress)) Stats.iMismatches++;
+        iPosition = iNext;
+        iTime += iDelta + Record->iDelta;
+        Stats.iRecords++;
+        return 1;
+    }
+
+    Stats.iMismatches++;
+
+    if ((iOp != DS1820_CAPTURE_RESET) && (iOp != DS1820_CAPTURE_MATCH) &&
+            (iOp != DS1820_CAPTURE_SKIP) && (iOp != DS1820_CAPTURE_SEARCH_FIRST)) return 0;
+
+    /* Skip to the next fitting transaction */
+    while (iNext) {
+        iDelta += Record->iDelta;
+        iAt = iNext;
+        iSkipped++;
+
+        iNext = RecordDecode(iAt, Record);
+        if ((iNext) && RecordFits(Record, iOp, iByte, iAddress)) {
+            iPosition = iNext;
+            iTime += iDelta + Record->iDelta;
+            Stats.iRecords++;
+            Stats.iSkipped += iSkipped;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Checks if record fits the call.
+ * @param Record Decoded record.
+ * @param iOp Called operation, DS1820_CaptureOp.
+ * @param iByte Written byte, family code or speed of the call.
+ * @param iAddress Matched address of the call.
+ * @return 1 if record fits.
+ */
+uint8_t RecordFits(const OW_ReplayRecord *Record, uint8_t iOp, uint8_t iByte, uint64_t iAddress) {
+    if (Record->iOp != iOp) return 0;
+
+    switch (iOp) {
+        case DS1820_CAPTURE_MATCH:
+            return Record->iAddress == iAddress;
+        case DS1820_CAPTURE_WRITE:
+        case DS1820_CAPTURE_SEARCH_FIRST:
+        case DS1820_CAPTURE_SPEED:
+            return Record->iByte == iByte;
+        default:
+            return 1;
+    }
+}
+
+/**
+ * Adds modeled duration of bus operation.
+ * @param iResets Number of resets.
+ * @param iSlots Number of time slots.
+ */
+void BusTime(uint32_t iResets, uint32_t iSlots) {
+    if (iSpeed == OW_SPEED_OVERDRIVE) {
+        Stats.iBusyTime += iResets * OW_SIM_RESET_TIME_OD + iSlots * OW_SIM_SLOT_TIME_OD;
+    } else {
+        Stats.iBusyTime += iResets * OW_SIM_RESET_TIME + iSlots * OW_SIM_SLOT_TIME;
+    }
+}
@@ -0,0 +1,1121 @@
+/**
+ *******************************************************************************
+ * @file    OneWire_Sim.c
+ * @author  Vojtech Vigner
+ * @brief   Discrete-event simulator of OneWire bus with DS1820 devices running
+ *          in virtual time. Implements the OneWire API used by DS1820.c.
+ *
+ * @attention
+ *          Time advances only by modeled durations of resets and time slots,
+ *          by OW_SimAdvance and OW_SimDelay, never by wall clock, so the same
+ *          sequence of calls always gives the same results. Conversion and
+ *          EEPROM copy completions are events processed in time order.
+ *          Parasite powered devices draw OW_SIM_CONVERSION_CURRENT during
+ *          conversion, the bus has to be in strong pull-up state by the next
+ *          bus operation or time advance, otherwise converting devices brown
+ *          out and restart with power-on scratchpad (+85 C).
+ *
+ *          All devices share one bus phase (ROM command, match, search,
+ *          function command), the devices taking part in it are kept in
+ *          bitset together with device properties and 64 address bit planes.
+ *          Match ROM and every search slot are whole word operations over
+ *          the bitsets, per device work is done for selected devices only, so
+ *          search on buses with thousands of devices stays cheap.
+ *
+ *          Faults set by OW_SimFaultsSet are drawn from seeded generator, the
+ *          same seed and calls give the same faults. Bit errors hit written
+ *          and read bits including search slots, missing presence hides the
+ *          presence pulse only, dropped device leaves the transaction and
+ *          sends ones, short holds the bus low until OW_SimShortClear and
+ *          parasite device browns out at random time during conversion.
+ *          Read scratchpad transactions with a bit error delivered to the
+ *          master are counted, so CRC coverage can be measured.
+ *
+ * @verbatim
+ *          ********************************************************************
+ *                                How to use this module
+ *          ********************************************************************
+ *          1. Build DS1820.c with code/sim in include path and link this file
+ *          instead of the OneWire library.
+ *
+ *          2. Create devices by OW_SimDeviceAdd(OW_SimAddress(0x10, i), 0)
+ *          and set their temperature by OW_SimTemperatureSet.
+ *
+ *          3. Register OW_SimTick and OW_SimDelay by DS1820_TickSet and
+ *          DS1820_DelaySet, use OW_SimDelay instead of waiting.
+ *
+ *          4. Read modeled bus time and events by OW_SimStatsGet.
+ *
+ *          5. Optionally inject faults by OW_SimFaultsSet.
+ *  @endverbatim
+ *******************************************************************************
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "OneWire.h"
+
+/* ROM commands */
+#define ROM_SEARCH              0xF0
+#define ROM_MATCH               0x55
+#define ROM_SKIP                0xCC
+#define ROM_MATCH_OVERDRIVE     0x69
+
+/* DS1820 function commands */
+#define FUNCTION_CONVERT        0x44
+#define FUNCTION_READ           0xBE
+#define FUNCTION_WRITE          0x4E
+#define FUNCTION_COPY           0x48
+#define FUNCTION_RECALL         0xB8
+#define FUNCTION_POWER          0xB4
+
+/* Scratchpad layout */
+#define PAD_LENGTH              9
+#define PAD_TH                  2
+#define PAD_TL                  3
+#define PAD_REMAIN              6
+#define PAD_PER_C               7
+#define PAD_CRC                 8
+
+/* Bus phases */
+#define PHASE_IDLE              0
+#define PHASE_ROM               1
+#define PHASE_MATCH             2
+#define PHASE_MATCH_OVERDRIVE   3
+#define PHASE_SELECTED          4
+#define PHASE_READ              5
+#define PHASE_WRITE             6
+#define PHASE_POWER             7
+#define PHASE_BUSY              8
+#define PHASE_SEARCH            9
+
+/* Device bitsets, address bit planes follow */
+#define SET_PRESENT             0
+#define SET_SELECTED            1
+#define SET_PARASITE            2
+#define SET_CAPABLE             3
+#define SET_OVERDRIVE           4
+#define SET_CONVERTING          5
+#define SET_PLANES              6
+#define SET_COUNT               (SET_PLANES + 64)
+
+/* Bits per bitset word */
+#define WORD_BITS               64
+
+/* Simulated DS1820 device */
+typedef struct _OW_SimDevice {
+    uint64_t iBusyUntil;
+    uint32_t iConversionTime;
+    uint32_t iGeneration;
+    int iTemp;
+    uint8_t Pad[PAD_LENGTH];
+    uint8_t EEPROM[2];
+} OW_SimDevice;
+
+/* Conversion completion or injected brown-out event */
+typedef struct _OW_SimEvent {
+    uint64_t iTime;
+    int iDevice;
+    uint32_t iGeneration;
+    uint8_t bBrownOut;
+} OW_SimEvent;
+
+/* Devices and their bitsets, SET_COUNT bitsets of iWords words each */
+static OW_SimDevice *Devices = 0;
+static int iDeviceCount = 0, iDeviceSize = 0;
+static uint64_t *Sets = 0;
+static int iWords = 0;
+
+static OW_SimEvent *Events = 0;
+static int iEventCount = 0, iEventSize = 0;
+
+/* Bus state */
+static uint64_t iNow = 0;
+static uint64_t iStrongStart = 0;
+static uint8_t iSpeed = OW_SPEED_STANDARD;
+static uint8_t bStrong = 0;
+static uint8_t iPhase = PHASE_IDLE;
+static uint8_t iPhaseCount = 0;
+static uint8_t iPhaseCommand = 0;
+static uint8_t bPhaseOverdrive = 0;
+static uint8_t bPhaseCorrupt = 0;
+static uint8_t bShort = 0;
+static uint32_t iWeakSupply = OW_SIM_WEAK_SUPPLY;
+static uint32_t iStrongSupply = OW_SIM_STRONG_SUPPLY;
+static OW_SimStats Stats;
+
+/* Fault injection */
+static OW_SimFaults Faults;
+static uint64_t iRandom = 1;
+
+/* Search state */
+static uint64_t iSearchROM = 0;
+static int iLastDiscrepancy = 0;
+static uint8_t bLastDevice = 0;
+static uint8_t iSearchFamily = 0;
+
+/* Internal functions */
+static void BusOperation(uint32_t iDuration);
+static uint32_t SlotTime(void);
+static void TimeRun(uint64_t iUntil);
+static void SupplyCheck(void);
+static void EventPush(uint64_t iTime, int iDevice, uint8_t bBrownOut);
+static void EventPop(void);
+static void DeviceComplete(int iDevice, uint32_t iGeneration, uint8_t bBrownOut);
+static void DeviceBrownOut(int iDevice);
+static void FunctionCommand(uint8_t iCommand);
+static uint8_t PhaseRead(void);
+static void PadTemperature(OW_SimDevice *Device);
+static void PadPowerOn(OW_SimDevice *Device);
+static void PadCRC(OW_SimDevice *Device);
+static uint64_t Search(void);
+static uint32_t Random(void);
+static uint8_t FaultRoll(uint32_t iRate);
+static uint8_t FaultBits(uint8_t iByte, int iBits);
+static void FaultDrop(void);
+static uint8_t FaultShort(void);
+static uint64_t *Set(int iSet);
+static uint8_t SetsGrow(int iNewWords);
+static void BitWrite(uint64_t *Bits, int iBit, uint8_t bValue);
+static uint8_t BitGet(const uint64_t *Bits, int iBit);
+static int BitNext(const uint64_t *Bits, int iFrom);
+static void BitsFilter(uint64_t *Bits, const uint64_t *Plane, uint8_t bValue);
+static int BitsCount(const uint64_t *Bits, const uint64_t *Mask);
+
+/**
+ * Initializes the bus, devices are kept.
+ */
+void OW_Init(void) {
+    iSpeed = OW_SPEED_STANDARD;
+    bStrong = 0;
+    iPhase = PHASE_IDLE;
+}
+
+/**
+ * Issues reset pulse and detects presence. Standard speed reset returns all
+ * devices to standard speed, overdrive reset is seen by overdrive devices
+ * only. Devices keep converting, they only drop communication state.
+ * @return OW_OK if any device answered, OW_NO_DEV if not.
+ */
+uint8_t OW_Reset(void) {
+    uint64_t *Selected = Set(SET_SELECTED), *Overdrive = Set(SET_OVERDRIVE);
+    int w;
+
+    BusOperation((iSpeed == OW_SPEED_OVERDRIVE) ? OW_SIM_RESET_TIME_OD : OW_SIM_RESET_TIME);
+    Stats.iResets++;
+
+    /* Bus held low looks like presence */
+    if (FaultShort()) {
+        iPhase = PHASE_IDLE;
+        return OW_OK;
+    }
+
+    if (iSpeed == OW_SPEED_STANDARD) {
+        for (w = 0; w < iWords; w++) Overdrive[w] = 0;
+        for (w = 0; w < iWords; w++) Selected[w] = Set(SET_PRESENT)[w];
+    } else {
+        for (w = 0; w < iWords; w++) Selected[w] = Overdrive[w];
+    }
+
+    bPhaseOverdrive = (iSpeed == OW_SPEED_OVERDRIVE);
+    iPhase = (BitsCount(Selected, 0)) ? PHASE_ROM : PHASE_IDLE;
+    if (iPhase == PHASE_IDLE) return OW_NO_DEV;
+
+    /* Devices were reset, master missed the presence pulse */
+    if (FaultRoll(Faults.iNoPresence)) {
+        Stats.iPresenceLost++;
+        return OW_NO_DEV;
+    }
+
+    return OW_OK;
+}
+
+/**
+ * Resets the bus and selects device by Match ROM or all devices by Skip ROM.
+ * @param iAddress 64bit device address, 0 for Skip ROM.
+ * @return OW_OK if any device answered reset, OW_NO_DEV if not.
+ */
+uint8_t OW_ROMMatch(uint64_t iAddress) {
+    int i;
+
+    if (OW_Reset() != OW_OK) return OW_NO_DEV;
+
+    if (iAddress == 0) {
+        OW_ByteWrite(ROM_SKIP);
+    } else {
+        OW_ByteWrite(ROM_MATCH);
+        for (i = 0; i < 8; i++) OW_ByteWrite((uint8_t) (iAddress >> (8 * i)));
+    }
+
+    return OW_OK;
+}
+
+/**
+ * Writes byte to selected devices listening at the current speed.
+ * @param iByte Byte to be written.
+ */
+void OW_ByteWrite(uint8_t iByte) {
+    uint64_t *Selected = Set(SET_SELECTED);
+    int i, w;
+
+    BusOperation(8 * SlotTime());
+    Stats.iBytesWritten++;
+
+    if (FaultShort()) return;
+    iByte = FaultBits(iByte, 8);
+    FaultDrop();
+
+    /* Devices do not see slots at the other speed, except Overdrive Match ROM
+     * address */
+    if (iPhase == PHASE_IDLE) return;
+    if ((iPhase != PHASE_MATCH_OVERDRIVE) && (bPhaseOverdrive != (iSpeed == OW_SPEED_OVERDRIVE))) return;
+
+    switch (iPhase) {
+        case PHASE_ROM:
+            iPhaseCount = 0;
+            if (iByte == ROM_SKIP) iPhase = PHASE_SELECTED;
+            else if (iByte == ROM_MATCH) iPhase = PHASE_MATCH;
+            else if (iByte == ROM_MATCH_OVERDRIVE) iPhase = PHASE_MATCH_OVERDRIVE;
+            else if (iByte == ROM_SEARCH) iPhase = PHASE_SEARCH;
+            else iPhase = PHASE_IDLE;
+            break;
+
+        case PHASE_MATCH_OVERDRIVE:
+            /* Address is sent at overdrive speed, only capable devices see it */
+            if (iSpeed != OW_SPEED_OVERDRIVE) {
+                iPhase = PHASE_IDLE;
+                break;
+            }
+            BitsFilter(Selected, Set(SET_CAPABLE), 1);
+            bPhaseOverdrive = 1;
+            iPhase = PHASE_MATCH;
+            /* Fall through */
+
+        case PHASE_MATCH:
+            /* Devices leave on the first mismatching address bit */
+            for (i = 0; i < 8; i++) BitsFilter(Selected, Set(SET_PLANES + 8 * iPhaseCount + i), (iByte >> i) & 1);
+
+            if (++iPhaseCount == 8) {
+                iPhase = (BitsCount(Selected, 0)) ? PHASE_SELECTED : PHASE_IDLE;
+                if (bPhaseOverdrive)
+                    for (w = 0; w < iWords; w++) Set(SET_OVERDRIVE)[w] |= Selected[w];
+            }
+            break;
+
+        case PHASE_SELECTED:
+            FunctionCommand(iByte);
+            break;
+
+        case PHASE_WRITE:
+            for (i = BitNext(Selected, 0); i >= 0; i = BitNext(Selected, i + 1)) {
+                Devices[i].Pad[(iPhaseCount == 0) ? PAD_TH : PAD_TL] = iByte;
+                if (iPhaseCount == 1) PadCRC(&Devices[i]);
+            }
+            if (++iPhaseCount == 2) iPhase = PHASE_IDLE;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * Reads byte, the bus is wired-AND of all selected devices sending data.
+ * @return Byte read, 0xFF if no device sends.
+ */
+uint8_t OW_ByteRead(void) {
+    uint8_t iByte = 0xFF, iReceived;
+
+    BusOperation(8 * SlotTime());
+    Stats.iBytesRead++;
+
+    if (FaultShort()) return 0x00;
+    FaultDrop();
+
+    if ((iPhase != PHASE_IDLE) && (bPhaseOverdrive == (iSpeed == OW_SPEED_OVERDRIVE))) iByte = PhaseRead();
+
+    /* Scratchpad read delivered with error, counted once per transaction */
+    iReceived = FaultBits(iByte, 8);
+    if ((iReceived != iByte) && (iPhase == PHASE_READ) && !bPhaseCorrupt) {
+        bPhaseCorrupt = 1;
+        Stats.iCorruptReads++;
+    }
+
+    return iReceived;
+}
+
+/**
+ * Dallas CRC8 of one byte.
+ * @param iCRC CRC of previous bytes.
+ * @param iByte Next byte.
+ * @return New CRC.
+ */
+uint8_t OW_CRCCalculate(uint8_t iCRC, uint8_t iByte) {
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        iCRC = ((iCRC ^ iByte) & 0x01) ? (uint8_t) ((iCRC >> 1) ^ 0x8C) : (uint8_t) (iCRC >> 1);
+        iByte >>= 1;
+    }
+
+    return iCRC;
+}
+
+/**
+ * Ends strong pull-up.
+ */
+void OW_WeakPullUp(void) {
+    BusOperation(0);
+}
+
+/**
+ * Starts strong pull-up, it lasts until the next bus operation.
+ */
+void OW_StrongPullUp(void) {
+    if (!bStrong) iStrongStart = iNow;
+    bStrong = 1;
+
+    SupplyCheck();
+}
+
+/**
+ * Starts ROM search.
+ * @param iFamily Family code of searched devices, 0 for all devices.
+ * @return 64bit address of the first device or 0 if no device was found.
+ */
+uint64_t OW_SearchFirst(uint8_t iFamily) {
+    iSearchFamily = iFamily;
+    iSearchROM = iFamily;
+    iLastDiscrepancy = (iFamily) ? 64 : 0;
+    bLastDevice = 0;
+
+    return Search();
+}
+
+/**
+ * Continues ROM search.
+ * @return 64bit address of the next device or 0 if there are no more devices.
+ */
+uint64_t OW_SearchNext(void) {
+    return Search();
+}
+
+/**
+ * Sets bus speed.
+ * @param iNewSpeed OW_SPEED_STANDARD or OW_SPEED_OVERDRIVE.
+ */
+void OW_SpeedSet(uint8_t iNewSpeed) {
+    iSpeed = iNewSpeed;
+}
+
+/**
+ * Removes all devices and resets virtual time and statistics.
+ */
+void OW_SimClear(void) {
+    OW_SimStats Empty = {0};
+
+    if (Sets) memset(Sets, 0, sizeof (uint64_t) * (size_t) iWords * SET_COUNT);
+
+    iDeviceCount = 0;
+    iEventCount = 0;
+    iNow = 0;
+    bStrong = 0;
+    iSpeed = OW_SPEED_STANDARD;
+    iPhase = PHASE_IDLE;
+    Stats = Empty;
+
+    OW_SimFaultsSet(0, 1);
+}
+
+/**
+ * Builds valid device address.
+ * @param iFamily Family code, 0x10 for DS1820.
+ * @param iSerial 48bit serial number.
+ * @return 64bit device address with CRC.
+ */
+uint64_t OW_SimAddress(uint8_t iFamily, uint64_t iSerial) {
+    uint64_t iAddress = iFamily | ((iSerial & 0xFFFFFFFFFFFFULL) << 8);
+    uint8_t iCRC = 0;
+    int i;
+
+    for (i = 0; i < 7; i++) iCRC = OW_CRCCalculate(iCRC, (uint8_t) (iAddress >> (8 * i)));
+
+    return iAddress | ((uint64_t) iCRC << 56);
+}
+
+/**
+ * Adds device to the bus, device starts with power-on scratchpad and 25 C.
+ * @param iAddress 64bit device address.
+ * @param bParasite 1 for parasite powered device.
+ * @return Device index or -1 if out of memory.
+ */
+int OW_SimDeviceAdd(uint64_t iAddress, uint8_t bParasite) {
+    OW_SimDevice *Device;
+    int i, iSize;
+
+    if (iDeviceCount == iDeviceSize) {
+        iSize = (iDeviceSize) ? 2 * iDeviceSize : WORD_BITS;
+        Device = realloc(Devices, sizeof (OW_SimDevice) * (size_t) iSize);
+        if (Device == 0) return -1;
+        Devices = Device;
+        if (!SetsGrow(iSize / WORD_BITS)) return -1;
+        iDeviceSize = iSize;
+    }
+
+    Device = &Devices[iDeviceCount];
+    Device->iBusyUntil = 0;
+    Device->iConversionTime = OW_SIM_CONVERSION_TIME;
+    Device->iGeneration = 0;
+    Device->iTemp = 250;
+    Device->EEPROM[0] = 75;
+    Device->EEPROM[1] = 70;
+    PadPowerOn(Device);
+
+    BitWrite(Set(SET_PRESENT), iDeviceCount, 1);
+    BitWrite(Set(SET_PARASITE), iDeviceCount, bParasite);
+    for (i = 0; i < 64; i++) BitWrite(Set(SET_PLANES + i), iDeviceCount, (iAddress >> i) & 1);
+
+    return iDeviceCount++;
+}
+
+/**
+ * Sets temperature measured by the next conversion.
+ * @param iDevice Device index.
+ * @param iTemp Temperature in degrees of Celsius * 10.
+ */
+void OW_SimTemperatureSet(int iDevice, int iTemp) {
+    Devices[iDevice].iTemp = iTemp;
+}
+
+/**
+ * Sets device conversion time.
+ * @param iDevice Device index.
+ * @param iMicroSeconds Conversion time.
+ */
+void OW_SimConversionTimeSet(int iDevice, uint32_t iMicroSeconds) {
+    Devices[iDevice].iConversionTime = iMicroSeconds;
+}
+
+/**
+ * Sets device overdrive capability.
+ * @param iDevice Device index.
+ * @param bOverdrive 1 if device supports overdrive speed.
+ */
+void OW_SimOverdriveSet(int iDevice, uint8_t bOverdrive) {
+    BitWrite(Set(SET_CAPABLE), iDevice, bOverdrive);
+}
+
+/**
+ * Sets current the bus can supply to parasite devices.
+ * @param iWeak Weak pull-up current in microamperes.
+ * @param iStrong Strong pull-up current in microamperes.
+ */
+void OW_SimSupplySet(uint32_t iWeak, uint32_t iStrong) {
+    iWeakSupply = iWeak;
+    iStrongSupply = iStrong;
+}
+
+/**
+ * Returns number of devices taking part in the current bus phase.
+ * @return Number of devices selected by the last reset, ROM command or search.
+ */
+int OW_SimSelected(void) {
+    return (iPhase == PHASE_IDLE) ? 0 : BitsCount(Set(SET_SELECTED), 0);
+}
+
+/**
+ * Sets fault probabilities and seeds fault generator. Faults are disabled by
+ * OW_SimClear.
+ * @param NewFaults Fault probabilities in parts per million (OW_SIM_PPM) of
+ * transferred bits, resets, transferred bytes, bus operations and parasite 
+ * conversions, NULL to disable faults.
+ * @param iSeed Fault generator seed.
+ */
+void OW_SimFaultsSet(const OW_SimFaults *NewFaults, uint64_t iSeed) {
+    OW_SimFaults Empty = {0};
+
+    Faults = (NewFaults) ? *NewFaults : Empty;
+    iRandom = (iSeed) ? iSeed : 1;
+    bShort = 0;
+}
+
+/**
+ * Removes bus short.
+ */
+void OW_SimShortClear(void) {
+    bShort = 0;
+}
+
+/**
+ * Returns virtual time.
+ * @return Microseconds since OW_SimClear.
+ */
+uint64_t OW_SimTime(void) {
+    return iNow;
+}
+
+/**
+ * Advances virtual time, bus is idle or in strong pull-up meanwhile.
+ * @param iMicroSeconds Time step.
+ */
+void OW_SimAdvance(uint64_t iMicroSeconds) {
+    SupplyCheck();
+    TimeRun(iNow + iMicroSeconds);
+}
+
+/**
+ * Virtual miliseconds tick, see DS1820_TickSet.
+ * @return Miliseconds since OW_SimClear.
+ */
+uint32_t OW_SimTick(void) {
+    return (uint32_t) (iNow / 1000);
+}
+
+/**
+ * Virtual delay, see DS1820_DelaySet.
+ * @param iMiliSeconds Delay.
+ */
+void OW_SimDelay(int iMiliSeconds) {
+    OW_SimAdvance((uint64_t) iMiliSeconds * 1000);
+}
+
+/**
+ * Returns simulator statistics.
+ * @param Output Statistics output.
+ */
+void OW_SimStatsGet(OW_SimStats *Output) {
+    *Output = Stats;
+    if (bStrong) Output->iStrongTime += iNow - iStrongStart;
+}
+
+/**
+ * Ends strong pull-up, checks parasite supply and runs the bus for duration
+ * of the operation.
+ * @param iDuration Operation duration in microseconds.
+ */
+void BusOperation(uint32_t iDuration) {
+    TimeRun(iNow);
+
+    if (bStrong) {
+        Stats.iStrongTime += iNow - iStrongStart;
+        bStrong = 0;
+    }
+
+    SupplyCheck();
+
+    Stats.iBusyTime += iDuration;
+    TimeRun(iNow + iDuration);
+}
+
+/**
+ * Returns time slot duration at the current speed.
+ * @return Microseconds.
+ */
+uint32_t SlotTime(void) {
+    return (iSpeed == OW_SPEED_OVERDRIVE) ? OW_SIM_SLOT_TIME_OD : OW_SIM_SLOT_TIME;
+}
+
+/**
+ * Processes events in time order up to given time.
+ * @param iUntil Virtual time to run to.
+ */
+void TimeRun(uint64_t iUntil) {
+    OW_SimEvent Event;
+
+    while ((iEventCount) && (Events[0].iTime <= iUntil)) {
+        Event = Events[0];
+        EventPop();
+
+        iNow = Event.iTime;
+        DeviceComplete(Event.iDevice, Event.iGeneration, Event.bBrownOut);
+    }
+
+    if (iUntil > iNow) iNow = iUntil;
+}
+
+/**
+ * Browns out converting parasite devices if the bus can not supply them.
+ */
+void SupplyCheck(void) {
+    uint64_t *Converting = Set(SET_CONVERTING), *Parasite = Set(SET_PARASITE);
+    int i;
+
+    if ((uint64_t) BitsCount(Converting, Parasite) * OW_SIM_CONVERSION_CURRENT <= ((bStrong) ? iStrongSupply : iWeakSupply))
+        return;
+
+    for (i = BitNext(Converting, 0); i >= 0; i = BitNext(Converting, i + 1))
+        if (BitGet(Parasite, i)) DeviceBrownOut(i);
+}
+
+/**
+ * Schedules completion of device conversion or injected brown-out.
+ * @param iTime Event time.
+ * @param iDevice Device index.
+ * @param bBrownOut 1 for brown-out event.
+ */
+void EventPush(uint64_t iTime, int iDevice, uint8_t bBrownOut) {
+    OW_SimEvent *New;
+    int i, iParent;
+
+    if (iEventCount == iEventSize) {
+        New = realloc(Events, sizeof (OW_SimEvent) * (size_t) (iEventSize ? 2 * iEventSize : 64));
+        if (New == 0) return;
+        Events = New;
+        iEventSize = iEventSize ? 2 * iEventSize : 64;
+    }
+
+    /* Binary heap ordered by time */
+    for (i = iEventCount++; i > 0; i = iParent) {
+        iParent = (i - 1) / 2;
+        if (Events[iParent].iTime <= iTime) break;
+        Events[i] = Events[iParent];
+    }
+
+    Events[i].iTime = iTime;
+    Events[i].iDevice = iDevice;
+    Events[i].iGeneration = Devices[iDevice].iGeneration;
+    Events[i].bBrownOut = bBrownOut;
+}
+
+/**
+ * Removes the earliest event.
+ */
+void EventPop(void) {
+    OW_SimEvent Last = Events[--iEventCount];
+    int i = 0, iChild;
+
+    while ((iChild = 2 * i + 1) < iEventCount) {
+        if ((iChild + 1 < iEventCount) && (Events[iChild + 1].iTime < Events[iChild].iTime)) iChild++;
+        if (Last.iTime <= Events[iChild].iTime) break;
+        Events[i] = Events[iChild];
+        i = iChild;
+    }
+
+    if (iEventCount) Events[i] = Last;
+}
+
+/**
+ * Completes device conversion or browns device out, events of already browned
+ * out devices are ignored.
+ * @param iDevice Device index.
+ * @param iGeneration Device generation at event creation.
+ * @param bBrownOut 1 for brown-out event.
+ */
+void DeviceComplete(int iDevice, uint32_t iGeneration, uint8_t bBrownOut) {
+    if (Devices[iDevice].iGeneration != iGeneration) return;
+    if (!BitGet(Set(SET_CONVERTING), iDevice)) return;
+
+    if (bBrownOut) {
+        DeviceBrownOut(iDevice);
+        return;
+    }
+
+    BitWrite(Set(SET_CONVERTING), iDevice, 0);
+    PadTemperature(&Devices[iDevice]);
+}
+
+/**
+ * Restarts device after power loss, device is silent until the next reset.
+ * @param iDevice Device index.
+ */
+void DeviceBrownOut(int iDevice) {
+    OW_SimDevice *Device = &Devices[iDevice];
+
+    BitWrite(Set(SET_CONVERTING), iDevice, 0);
+    BitWrite(Set(SET_OVERDRIVE), iDevice, 0);
+    BitWrite(Set(SET_SELECTED), iDevice, 0);
+
+    Device->iBusyUntil = 0;
+    Device->iGeneration++;
+    PadPowerOn(Device);
+
+    Stats.iBrownOuts++;
+}
+
+/**
+ * Starts function command on all selected devices.
+ * @param iCommand Function command.
+ */
+void FunctionCommand(uint8_t iCommand) {
+    uint64_t *Selected = Set(SET_SELECTED), *Converting = Set(SET_CONVERTING);
+    OW_SimDevice *Device;
+    int i;
+
+    /* Busy phase remembers its command */
+    iPhaseCount = 0;
+    iPhaseCommand = iCommand;
+    bPhaseCorrupt = 0;
+
+    switch (iCommand) {
+        case FUNCTION_READ:
+            iPhase = PHASE_READ;
+            return;
+        case FUNCTION_WRITE:
+            iPhase = PHASE_WRITE;
+            return;
+        case FUNCTION_POWER:
+            iPhase = PHASE_POWER;
+            return;
+        case FUNCTION_RECALL:
+        case FUNCTION_COPY:
+        case FUNCTION_CONVERT:
+            iPhase = PHASE_BUSY;
+            break;
+        default:
+            iPhase = PHASE_IDLE;
+            return;
+    }
+
+    for (i = BitNext(Selected, 0); i >= 0; i = BitNext(Selected, i + 1)) {
+        Device = &Devices[i];
+
+        if (iCommand == FUNCTION_RECALL) {
+            Device->Pad[PAD_TH] = Device->EEPROM[0];
+            Device->Pad[PAD_TL] = Device->EEPROM[1];
+            PadCRC(Device);
+        } else if (iCommand == FUNCTION_COPY) {
+            Device->EEPROM[0] = Device->Pad[PAD_TH];
+            Device->EEPROM[1] = Device->Pad[PAD_TL];
+            Device->iBusyUntil = iNow + OW_SIM_COPY_TIME;
+        } else if (!BitGet(Converting, i)) {
+            BitWrite(Converting, i, 1);
+            EventPush(iNow + Device->iConversionTime, i, 0);
+            Stats.iConversions++;
+
+            if (BitGet(Set(SET_PARASITE), i) && FaultRoll(Faults.iBrownOut))
+                EventPush(iNow + Random() % Device->iConversionTime, i, 1);
+        }
+    }
+}
+
+/**
+ * Returns byte sent by selected devices in the current phase.
+ * @return Wired-AND of sent bytes, 0xFF if no device sends.
+ */
+uint8_t PhaseRead(void) {
+    uint64_t *Selected = Set(SET_SELECTED), *Parasite = Set(SET_PARASITE);
+    uint8_t iByte = 0xFF;
+    int i;
+
+    switch (iPhase) {
+        case PHASE_READ:
+            if (iPhaseCount >= PAD_LENGTH) return 0xFF;
+            for (i = BitNext(Selected, 0); i >= 0; i = BitNext(Selected, i + 1))
+                iByte &= Devices[i].Pad[iPhaseCount];
+            iPhaseCount++;
+            return iByte;
+
+        case PHASE_POWER:
+            return (BitsCount(Selected, Parasite)) ? 0x00 : 0xFF;
+
+        case PHASE_BUSY:
+            /* Externally powered devices hold zeros until done */
+            if (iPhaseCommand == FUNCTION_CONVERT) {
+                for (i = BitNext(Selected, 0); i >= 0; i = BitNext(Selected, i + 1))
+                    if (!BitGet(Parasite, i) && BitGet(Set(SET_CONVERTING), i)) return 0x00;
+            } else if (iPhaseCommand == FUNCTION_COPY) {
+                for (i = BitNext(Selected, 0); i >= 0; i = BitNext(Selected, i + 1))
+                    if (!BitGet(Parasite, i) && (iNow < Devices[i].iBusyUntil)) return 0x00;
+            }
+            return 0xFF;
+
+        default:
+            return 0xFF;
+    }
+}
+
+/**
+ * Stores device temperature into scratchpad as DS18S20 conversion would.
+ * @param Device Simulated device.
+ */
+void PadTemperature(OW_SimDevice *Device) {
+    int iHalf, iWhole, iRemain, iFraction;
+
+    /* Register holds temperature rounded to 0.5 C */
+    iHalf = (Device->iTemp >= 0) ? (Device->iTemp + 2) / 5 : -((2 - Device->iTemp) / 5);
+
+    /* Datasheet formula truncates 0.5 C bit, COUNT_REMAIN holds the rest 
+     * from -0.25 to +0.75 C in 1/16 C */
+    iWhole = (iHalf >= 0) ? iHalf / 2 : -((1 - iHalf) / 2);
+    iFraction = (Device->iTemp - iWhole * 10) * 16;
+    iFraction = (iFraction >= 0) ? (iFraction + 5) / 10 : -((5 - iFraction) / 10);
+    iRemain = 12 - iFraction;
+    if (iRemain < 0) iRemain = 0;
+    if (iRemain > 16) iRemain = 16;
+
+    Device->Pad[0] = (uint8_t) iHalf;
+    Device->Pad[1] = (iHalf < 0) ? 0xFF : 0x00;
+    Device->Pad[PAD_REMAIN] = (uint8_t) iRemain;
+    Device->Pad[PAD_PER_C] = 0x10;
+    PadCRC(Device);
+}
+
+/**
+ * Loads power-on scratchpad, +85 C and thresholds from EEPROM.
+ * @param Device Simulated device.
+ */
+void PadPowerOn(OW_SimDevice *Device) {
+    Device->Pad[0] = 0xAA;
+    Device->Pad[1] = 0x00;
+    Device->Pad[PAD_TH] = Device->EEPROM[0];
+    Device->Pad[PAD_TL] = Device->EEPROM[1];
+    Device->Pad[4] = 0xFF;
+    Device->Pad[5] = 0xFF;
+    Device->Pad[PAD_REMAIN] = 0x0C;
+    Device->Pad[PAD_PER_C] = 0x10;
+    PadCRC(Device);
+}
+
+/**
+ * Updates scratchpad CRC.
+ * @param Device Simulated device.
+ */
+void PadCRC(OW_SimDevice *Device) {
+    uint8_t iCRC = 0;
+    int i;
+
+    for (i = 0; i < PAD_CRC; i++) iCRC = OW_CRCCalculate(iCRC, Device->Pad[i]);
+
+    Device->Pad[PAD_CRC] = iCRC;
+}
+
+/**
+ * One ROM search pass, standard 1-Wire search algorithm. Bit and complement
+ * slots of all participating devices are computed at once from address bit
+ * planes.
+ * @return 64bit address of found device or 0 if there are no more devices.
+ */
+uint64_t Search(void) {
+    uint64_t iROM = 0, iOnes, iZeros;
+    uint64_t *Selected = Set(SET_SELECTED), *Plane;
+    int w, iBit, iLastZero = 0;
+    uint8_t bId, bCmp, bDirection;
+
+    if (bLastDevice) return 0;
+
+    if (OW_Reset() != OW_OK) return 0;
+    OW_ByteWrite(ROM_SEARCH);
+    Stats.iSearches++;
+
+    /* Devices at the other speed or not in search take no part */
+    if (iPhase != PHASE_SEARCH)
+        for (w = 0; w < iWords; w++) Selected[w] = 0;
+
+    for (iBit = 0; iBit < 64; iBit++) {
+        BusOperation(3 * SlotTime());
+
+        /* Any participant with one pulls complement low and vice versa */
+        Plane = Set(SET_PLANES + iBit);
+        iOnes = 0;
+        iZeros = 0;
+        for (w = 0; w < iWords; w++) {
+            iOnes |= Selected[w] & Plane[w];
+            iZeros |= Selected[w] & ~Plane[w];
+        }
+
+        bId = FaultBits(iZeros == 0, 1);
+        bCmp = FaultBits(iOnes == 0, 1);
+
+        if ((bId) && (bCmp)) break;
+
+        if (bId != bCmp) {
+            bDirection = bId;
+        } else {
+            if (iBit + 1 < iLastDiscrepancy) bDirection = (iSearchROM >> iBit) & 1;
+            else bDirection = (iBit + 1 == iLastDiscrepancy);
+            if (bDirection == 0) iLastZero = iBit + 1;
+        }
+
+        if (bDirection) iROM |= (uint64_t) 1 << iBit;
+
+        BitsFilter(Selected, Plane, FaultBits(bDirection, 1));
+    }
+
+    iPhase = PHASE_IDLE;
+
+    /* No device answered */
+    if (iBit < 64) {
+        bLastDevice = 1;
+        return 0;
+    }
+
+    iLastDiscrepancy = iLastZero;
+    if (iLastDiscrepancy == 0) bLastDevice = 1;
+    iSearchROM = iROM;
+
+    if ((iSearchFamily) && ((uint8_t) iROM != iSearchFamily)) {
+        bLastDevice = 1;
+        return 0;
+    }
+
+    return iROM;
+}
+
+/**
+ * Fault generator, xorshift64*.
+ * @return Pseudorandom number.
+ */
+uint32_t Random(void) {
+    iRandom ^= iRandom >> 12;
+    iRandom ^= iRandom << 25;
+    iRandom ^= iRandom >> 27;
+
+    return (uint32_t) ((iRandom * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/**
+ * Decides if fault happens, zero rate does not use the generator.
+ * @param iRate Fault probability in parts per million.
+ * @return 1 if fault happens.
+ */
+uint8_t FaultRoll(uint32_t iRate) {
+    return (iRate) && (Random() % OW_SIM_PPM < iRate);
+}
+
+/**
+ * Flips transferred bits according to bit error rate.
+ * @param iByte Transferred bits.
+ * @param iBits Number of transferred bits.
+ * @return Bits as received.
+ */
+uint8_t FaultBits(uint8_t iByte, int iBits) {
+    int i;
+
+    for (i = 0; (Faults.iBitError) && (i < iBits); i++) {
+        if (FaultRoll(Faults.iBitError)) {
+            iByte ^= (uint8_t) (1 << i);
+            Stats.iBitErrors++;
+        }
+    }
+
+    return iByte;
+}
+
+/**
+ * Removes random selected device from function command transaction.
+ */
+void FaultDrop(void) {
+    uint64_t *Selected = Set(SET_SELECTED);
+    int i;
+
+    if ((iPhase < PHASE_SELECTED) || (iPhase > PHASE_BUSY) || !FaultRoll(Faults.iDrop)) return;
+
+    i = BitNext(Selected, (int) (Random() % (uint32_t) iDeviceCount));
+    if (i < 0) i = BitNext(Selected, 0);
+    if (i < 0) return;
+
+    BitWrite(Selected, i, 0);
+    Stats.iDrops++;
+}
+
+/**
+ * Checks sticky bus short, starts it with its probability.
+ * @return 1 if bus is shorted.
+ */
+uint8_t FaultShort(void) {
+    if ((!bShort) && FaultRoll(Faults.iShort)) {
+        bShort = 1;
+        Stats.iShorts++;
+    }
+
+    return bShort;
+}
+
+/**
+ * Returns device bitset.
+ * @param iSet Bitset index, SET_* or SET_PLANES + address bit.
+ * @return Bitset of iWords words.
+ */
+uint64_t *Set(int iSet) {
+    return &Sets[(size_t) iSet * (size_t) iWords];
+}
+
+/**
+ * Enlarges all bitsets, new bits are cleared.
+ * @param iNewWords New bitset length in words.
+ * @return 1 if successfull, 0 if out of memory.
+ */
+uint8_t SetsGrow(int iNewWords) {
+    uint64_t *New;
+    int i;
+
+    New = calloc((size_t) iNewWords * SET_COUNT, sizeof (uint64_t));
+    if (New == 0) return 0;
+
+    for (i = 0; (Sets) && (i < SET_COUNT); i++)
+        memcpy(&New[(size_t) i * (size_t) iNewWords], Set(i), sizeof (uint64_t) * (size_t) iWords);
+
+    free(Sets);
+    Sets = New;
+    iWords = iNewWords;
+
+    return 1;
+}
+
+/**
+ * Sets or clears one bit.
+ * @param Bits Bitset.
+ * @param iBit Bit index.
+ * @param bValue New bit value.
+ */
+void BitWrite(uint64_t *Bits, int iBit, uint8_t bValue) {
+    if (bValue) Bits[iBit / WORD_BITS] |= (uint64_t) 1 << (iBit % WORD_BITS);
+    else Bits[iBit / WORD_BITS] &= ~((uint64_t) 1 << (iBit % WORD_BITS));
+}
+
+/**
+ * Returns one bit.
+ * @param Bits Bitset.
+ * @param iBit Bit index.
+ * @return Bit value.
+ */
+uint8_t BitGet(const uint64_t *Bits, int iBit) {
+    return (Bits[iBit / WORD_BITS] >> (iBit % WORD_BITS)) & 1;
+}
+
+/**
+ * Finds the next set bit.
+ * @param Bits Bitset.
+ * @param iFrom Index of the first bit to check.
+ * @return Index of set bit or -1 if there is none.
+ */
+int BitNext(const uint64_t *Bits, int iFrom) {
+    int w = iFrom / WORD_BITS;
+    uint64_t iWord;
+
+    if (w >= iWords) return -1;
+
+    iWord = Bits[w] & (~(uint64_t) 0 << (iFrom % WORD_BITS));
+    while (iWord == 0) {
+        if (++w >= iWords) return -1;
+        iWord = Bits[w];
+    }
+
+    return w * WORD_BITS + __builtin_ctzll(iWord);
+}
+
+/**
+ * Keeps only bits whose plane bit equals given value.
+ * @param Bits Bitset to be filtered.
+ * @param Plane Address bit plane or property bitset.
+ * @param bValue Required plane bit value.
+ */
+void BitsFilter(uint64_t *Bits, const uint64_t *Plane, uint8_t bValue) {
+    uint64_t iMask = (bValue) ? 0 : ~(uint64_t) 0;
+    int w;
+
+    for (w = 0; w < iWords; w++) Bits[w] &= Plane[w] ^ iMask;
+}
+
+/**
+ * Counts bits set in bitset or in intersection of two bitsets.
+ * @param Bits Bitset.
+ * @param Mask Second bitset or NULL.
+ * @return Number of bits set.
+ */
+int BitsCount(const uint64_t *Bits, const uint64_t *Mask) {
+    int w, iCount = 0;
+
+    for (w = 0; w < iWords; w++) iCount += __builtin_popcountll((Mask) ? Bits[w] & Mask[w] : Bits[w]);
+
+    return iCount;
+}
@@ -0,0 +1,271 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_CaptureCheck.c
+ * @author  Vojtech Vigner
+ * @brief   Host check of bus capture and replay. The same session is run on
+ *          simulated bus with injected faults while capturing, then on replay
+ *          of the capture, and readings and bus time of both runs are compared.
+ *
+ * @verbatim
+ *          Build:  cc -DDS1820_CAPTURE_ENABLE -I.. -I../sim DS1820_CaptureCheck.c
+ *                  ../DS1820.c ../DS1820_Capture.c ../sim/OneWire_Sim.c
+ *                  -o DS1820_CaptureRecord
+ *                  cc -I.. -I../sim DS1820_CaptureCheck.c ../DS1820.c
+ *                  ../sim/OneWire_Replay.c -o DS1820_CaptureReplay
+ *
+ *          Usage:  DS1820_CaptureRecord capture [seed] [bit error ppm]
+ *                  DS1820_CaptureReplay capture
+ *
+ *          Both backends implement the OneWire API, so the program is built
+ *          twice. Record build runs the session on 8 simulated devices, half
+ *          of them parasite powered, with bit errors and missing presence
+ *          (2 % of resets) injected after discovery, as the capture does
+ *          not hold bus time of a search broken by fault. It writes the
+ *          capture and, into capture.txt, simulated bus time and every
+ *          reading (handle, time, temperature). Replay build
+ *          runs the same session on the capture and compares. It prints
+ *          mismatching and left records and returns nonzero if readings or
+ *          bus time differ or the replay did not match the capture.
+ *  @endverbatim
+ *******************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "OneWire.h"
+#include "DS1820.h"
+#ifdef DS1820_CAPTURE_ENABLE
+#include "DS1820_Capture.h"
+#endif
+
+#define DEVICES     8
+#define PASSES      50
+#define SAMPLES_MAX (DEVICES * PASSES * 2)
+
+/* Resets without presence in parts per million */
+#define NO_PRESENCE 20000
+
+/* Reading of the read engine */
+typedef struct _Sample {
+    int iHandle;
+    uint32_t iTime;
+    int iTemp;
+} Sample;
+
+static Sample Samples[SAMPLES_MAX];
+static int iSamples;
+static void (*DelayFunc)(int iMiliSeconds);
+
+#ifdef DS1820_CAPTURE_ENABLE
+static FILE *CaptureFile;
+#endif
+
+/* Internal functions */
+static void SampleStore(int iHandle, uint32_t iTime, int iTemp);
+static void Discover(void);
+static void Read(void);
+#ifdef DS1820_CAPTURE_ENABLE
+static void CaptureWrite(const uint8_t *Data, int iLength);
+static int Record(const char *sPath, uint64_t iSeed, uint32_t iBitError);
+#else
+static int Replay(const char *sPath);
+#endif
+
+int main(int argc, char **argv) {
+#ifdef DS1820_CAPTURE_ENABLE
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s capture [seed] [bit error ppm]\n", argv[0]);
+        return 1;
+    }
+
+    return Record(argv[1], (argc > 2) ? strtoull(argv[2], NULL, 0) : 1,
+            (argc > 3) ? (uint32_t) atol(argv[3]) : 300);
+#else
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s capture\n", argv[0]);
+        return 1;
+    }
+
+    return Replay(argv[1]);
+#endif
+}
+
+/**
+ * Read engine consumer, stores readings in order.
+ * @param iHandle Device handle.
+ * @param iTime Sample time.
+ * @param iTemp Temperature in degrees of Celsius * 10.
+ */
+void SampleStore(int iHandle, uint32_t iTime, int iTemp) {
+    if (iSamples >= SAMPLES_MAX) return;
+
+    Samples[iSamples].iHandle = iHandle;
+    Samples[iSamples].iTime = iTime;
+    Samples[iSamples].iTemp = iTemp;
+    iSamples++;
+}
+
+/**
+ * First part of application session, device discovery.
+ */
+void Discover(void) {
+    uint64_t Addresses[DS1820_MAX_DEVICES];
+
+    DS1820_SampleSinkAdd(SampleStore);
+    DS1820_Init();
+    DS1820_Search(Addresses, DS1820_MAX_DEVICES);
+}
+
+/**
+ * Second part of application session, power map and periodic reading of all
+ * devices.
+ */
+void Read(void) {
+    int i;
+
+    DS1820_PowerMapBuild();
+
+    for (i = 0; i < PASSES; i++) {
+        DS1820_TemperatureConvert(DS1820_ADDRESS_ALL);
+        DelayFunc(DS1820_CONVERSION_TIME);
+        DS1820_TemperatureReadAll();
+    }
+}
+
+#ifdef DS1820_CAPTURE_ENABLE
+
+/**
+ * Capture writer, appends records to the capture file.
+ * @param Data Record.
+ * @param iLength Record length.
+ */
+void CaptureWrite(const uint8_t *Data, int iLength) {
+    fwrite(Data, 1, (size_t) iLength, CaptureFile);
+}
+
+/**
+ * Runs session on simulated bus while capturing it, writes capture and
+ * expected results.
+ * @param sPath Capture file path, results go into sPath.txt.
+ * @param iSeed Fault generator seed.
+ * @param iBitError Bit error rate in parts per million.
+ * @return 0 if successfull, 1 if files could not be written.
+ */
+int Record(const char *sPath, uint64_t iSeed, uint32_t iBitError) {
+    OW_SimFaults Faults = {0};
+    OW_SimStats Stats;
+    char sResults[1024];
+    FILE *Results;
+    int i;
+
+    snprintf(sResults, sizeof (sResults), "%s.txt", sPath);
+    CaptureFile = fopen(sPath, "wb");
+    Results = fopen(sResults, "w");
+    if ((CaptureFile == 0) || (Results == 0)) {
+        fprintf(stderr, "Can not write %s\n", (CaptureFile == 0) ? sPath : sResults);
+        return 1;
+    }
+
+    OW_SimClear();
+    for (i = 0; i < DEVICES; i++)
+        OW_SimTemperatureSet(OW_SimDeviceAdd(OW_SimAddress(DS1820_FAMILY_CODE, 77 * i + 3), i & 1),
+            -100 + 37 * i);
+
+    DS1820_TickSet(OW_SimTick);
+    DS1820_DelaySet(OW_SimDelay);
+    DelayFunc = OW_SimDelay;
+
+    /* Bus time of a search broken by fault is not in the capture */
+    DS1820_CaptureSet(CaptureWrite);
+    Discover();
+
+    Faults.iBitError = iBitError;
+    Faults.iNoPresence = NO_PRESENCE;
+    OW_SimFaultsSet(&Faults, iSeed);
+    Read();
+    DS1820_CaptureSet(0);
+
+    OW_SimStatsGet(&Stats);
+    fprintf(Results, "%llu\n", (unsigned long long) Stats.iBusyTime);
+    for (i = 0; i < iSamples; i++)
+        fprintf(Results, "%d %u %d\n", Samples[i].iHandle, Samples[i].iTime, Samples[i].iTemp);
+
+    printf("captured %ld bytes, %d samples, bus time %llu us, %u bit errors, %u presence lost\n",
+            ftell(CaptureFile), iSamples, (unsigned long long) Stats.iBusyTime,
+            Stats.iBitErrors, Stats.iPresenceLost);
+
+    fclose(CaptureFile);
+    fclose(Results);
+
+    return 0;
+}
+
+#else
+
+/**
+ * Runs session on replay of capture and compares results with the recorded
+ * ones.
+ * @param sPath Capture file path, expected results are read from sPath.txt.
+ * @return 0 if replay is identical, 1 if not.
+ */
+int Replay(const char *sPath) {
+    static uint8_t Data[1 << 22];
+    OW_ReplayStats Stats;
+    Sample Expected;
+    unsigned long long iBusyTime;
+    char sResults[1024];
+    FILE *File;
+    int i, iLength, iDiffers = 0;
+
+    snprintf(sResults, sizeof (sResults), "%s.txt", sPath);
+
+    File = fopen(sPath, "rb");
+    if (File == 0) {
+        fprintf(stderr, "Can not read %s\n", sPath);
+        return 1;
+    }
+    iLength = (int) fread(Data, 1, sizeof (Data), File);
+    fclose(File);
+
+    if (OW_ReplayLoad(Data, iLength)) {
+        fprintf(stderr, "Invalid capture %s\n", sPath);
+        return 1;
+    }
+
+    DS1820_TickSet(OW_ReplayTick);
+    DS1820_DelaySet(OW_ReplayDelay);
+    DelayFunc = OW_ReplayDelay;
+
+    Discover();
+    Read();
+    OW_ReplayStatsGet(&Stats);
+
+    File = fopen(sResults, "r");
+    if ((File == 0) || (fscanf(File, "%llu", &iBusyTime) != 1)) {
+        fprintf(stderr, "Can not read %s\n", sResults);
+        return 1;
+    }
+
+    for (i = 0; fscanf(File, "%d %u %d", &Expected.iHandle, &Expected.iTime, &Expected.iTemp) == 3; i++)
+        if ((i >= iSamples) || (memcmp(&Samples[i], &Expected, sizeof (Sample)))) iDiffers++;
+    fclose(File);
+
+    if (i != iSamples) iDiffers++;
+
+    printf("replayed %u records in %u calls, %d of %d samples, bus time %llu of %llu us\n",
+            Stats.iRecords, Stats.iCalls, iSamples, i, (unsigned long long) Stats.iBusyTime, iBusyTime);
+    printf("mismatches %u, skipped %u, left %u, differing samples %d\n",
+            Stats.iMismatches, Stats.iSkipped, Stats.iLeft, iDiffers);
+
+    if (iDiffers || Stats.iMismatches || Stats.iLeft || (Stats.iBusyTime != iBusyTime)) {
+        printf("replay differs\n");
+        return 1;
+    }
+
+    printf("replay identical\n");
+
+    return 0;
+}
+
+#endif
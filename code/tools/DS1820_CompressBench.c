@@ -0,0 +1,193 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_CompressBench.c
+ * @author  Vojtech Vigner
+ * @brief   Host benchmark of time series compression. Compresses synthetic
+ *          temperature series into blocks, decompresses them, checks the
+ *          round trip and reports compression ratio and throughput.
+ *
+ * @verbatim
+ *          Build:  cc -O2 -I.. DS1820_CompressBench.c ../DS1820_Compress.c
+ *                  -o DS1820_CompressBench
+ *
+ *          Usage:  DS1820_CompressBench [samples] [block size] [seed]
+ *
+ *          Series is sampled at 1 Hz, every 64th timestamp is one second
+ *          late. Temperature is a random walk around 20 C which changes by
+ *          0.1 C in one of four samples and jumps by up to 10 C in one of
+ *          10000 samples. Throughput is raw series size (8 bytes per sample)
+ *          per second of processor time. Every decoded sample is compared
+ *          with the original and block lookup is checked for random
+ *          timestamps, the program returns nonzero if anything differs.
+ *          The same seed gives the same series.
+ *  @endverbatim
+ *******************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "DS1820_Compress.h"
+
+/* Number of random block lookups */
+#define LOOKUPS     100000
+
+/* Smallest block size in bytes */
+#define BLOCK_MIN   64
+
+static uint64_t iState;
+
+/* Internal functions */
+static uint64_t Random(void);
+static uint8_t *BlockAlloc(uint32_t iSize);
+static double Seconds(clock_t iStart);
+
+int main(int argc, char **argv) {
+    long i, j, iSamples = 20000000;
+    uint32_t iSize = 4096, iTime;
+    uint32_t *Times, *Lengths;
+    int *Values, iValue, iBlocks = 0, iBlock, iMaxBlocks;
+    uint8_t **Blocks;
+    DS1820_CompressWriter Writer;
+    DS1820_CompressReader Reader;
+    uint64_t iBytes = 0;
+    double fCompress, fDecompress;
+    clock_t iStart;
+
+    iState = 1;
+    if (argc > 1) iSamples = atol(argv[1]);
+    if (argc > 2) iSize = (uint32_t) atol(argv[2]);
+    if (argc > 3) iState = strtoull(argv[3], NULL, 0);
+
+    if ((iSamples < 1) || (iSize < BLOCK_MIN) || (iState == 0)) {
+        fprintf(stderr, "Usage: %s [samples] [block size, at least %d] [seed, nonzero]\n",
+                argv[0], BLOCK_MIN);
+        return 1;
+    }
+
+    /* Full block is filled up to the longest sample, 9 bytes */
+    iMaxBlocks = (int) (9 * iSamples / (iSize - DS1820_COMPRESS_HEADER - 9)) + 1;
+
+    Times = malloc(iSamples * sizeof (uint32_t));
+    Values = malloc(iSamples * sizeof (int));
+    Lengths = malloc(iMaxBlocks * sizeof (uint32_t));
+    Blocks = malloc(iMaxBlocks * sizeof (uint8_t *));
+
+    if ((Times == 0) || (Values == 0) || (Lengths == 0) || (Blocks == 0)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    for (i = 0, iTime = 0, iValue = 200; i < iSamples; i++) {
+        iTime += ((i & 63) == 63) ? 2 : 1;
+        if ((Random() & 3) == 0) iValue += (Random() & 1) ? 1 : -1;
+        if ((Random() % 10000) == 0) iValue += (int) (Random() % 201) - 100;
+        Times[i] = iTime;
+        Values[i] = iValue;
+    }
+
+    iStart = clock();
+    Blocks[0] = BlockAlloc(iSize);
+    DS1820_CompressInit(&Writer, Blocks[0], iSize);
+    for (i = 0; i < iSamples; i++) {
+        if (DS1820_CompressAppend(&Writer, Times[i], Values[i]) == DS1820_OK) continue;
+
+        Lengths[iBlocks] = DS1820_CompressFinish(&Writer);
+        iBytes += Lengths[iBlocks++];
+        Blocks[iBlocks] = BlockAlloc(iSize);
+        DS1820_CompressInit(&Writer, Blocks[iBlocks], iSize);
+        DS1820_CompressAppend(&Writer, Times[i], Values[i]);
+    }
+    Lengths[iBlocks] = DS1820_CompressFinish(&Writer);
+    iBytes += Lengths[iBlocks++];
+    fCompress = Seconds(iStart);
+
+    /* Decoded samples are only summed so the check does not count */
+    iStart = clock();
+    for (iBlock = 0, j = 0; iBlock < iBlocks; iBlock++) {
+        DS1820_DecompressInit(&Reader, Blocks[iBlock], Lengths[iBlock]);
+        while (DS1820_DecompressNext(&Reader, &iTime, &iValue)) j += iTime + iValue;
+    }
+    fDecompress = Seconds(iStart);
+
+    for (iBlock = 0, i = 0; iBlock < iBlocks; iBlock++) {
+        DS1820_DecompressInit(&Reader, Blocks[iBlock], Lengths[iBlock]);
+        while (DS1820_DecompressNext(&Reader, &iTime, &iValue)) {
+            if ((i >= iSamples) || (Times[i] != iTime) || (Values[i] != iValue)) {
+                fprintf(stderr, "Sample %ld differs\n", i);
+                return 1;
+            }
+            i++;
+        }
+    }
+
+    if (i != iSamples) {
+        fprintf(stderr, "Decoded %ld of %ld samples\n", i, iSamples);
+        return 1;
+    }
+
+    /* Found block starts at or before the sample, the next one after it */
+    for (j = 0; j < LOOKUPS; j++) {
+        i = (long) (Random() % (uint64_t) iSamples);
+        iBlock = DS1820_CompressBlockFind((const uint8_t * const *) Blocks, iBlocks, Times[i]);
+
+        if ((iBlock < 0) || (DS1820_CompressBlockTime(Blocks[iBlock]) > Times[i]) ||
+                ((iBlock + 1 < iBlocks) && (DS1820_CompressBlockTime(Blocks[iBlock + 1]) <= Times[i]))) {
+            fprintf(stderr, "Lookup of sample %ld failed\n", i);
+            return 1;
+        }
+    }
+
+    printf("samples          %ld\n", iSamples);
+    printf("blocks           %d of %u bytes max\n", iBlocks, iSize);
+    printf("compressed       %llu bytes, %.2f bits per sample, ratio %.1f\n",
+            (unsigned long long) iBytes, 8.0 * iBytes / iSamples, 8.0 * iSamples / iBytes);
+    printf("compress         %.0f MB/s\n", 8.0 * iSamples / fCompress / 1e6);
+    printf("decompress       %.0f MB/s\n", 8.0 * iSamples / fDecompress / 1e6);
+    printf("round trip       ok, %d lookups ok\n", LOOKUPS);
+
+    for (iBlock = 0; iBlock < iBlocks; iBlock++) free(Blocks[iBlock]);
+    free(Times);
+    free(Values);
+    free(Lengths);
+    free(Blocks);
+
+    return 0;
+}
+
+/**
+ * Pseudorandom generator, xorshift64*.
+ * @return Next random number.
+ */
+uint64_t Random(void) {
+    iState ^= iState >> 12;
+    iState ^= iState << 25;
+    iState ^= iState >> 27;
+
+    return iState * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Allocates block buffer, exits if out of memory.
+ * @param iSize Block size in bytes.
+ * @return Block buffer.
+ */
+uint8_t *BlockAlloc(uint32_t iSize) {
+    uint8_t *pBlock = malloc(iSize);
+
+    if (pBlock == 0) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    return pBlock;
+}
+
+/**
+ * Returns processor time since start.
+ * @param iStart Start of measurement.
+ * @return Seconds.
+ */
+double Seconds(clock_t iStart) {
+    return (double) (clock() - iStart) / CLOCKS_PER_SEC;
+}
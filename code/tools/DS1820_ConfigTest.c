@@ -0,0 +1,146 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_ConfigTest.c
+ * @author  Vojtech Vigner
+ * @brief   Host test of DS1820 temperature alarm thresholds and configuration
+ *          store on simulated bus. Stored thresholds are checked after recall
+ *          from EEPROM.
+ *
+ * @verbatim
+ *          Build:  cc -I.. -I../sim DS1820_ConfigTest.c ../DS1820.c
+ *                  ../sim/OneWire_Sim.c -o DS1820_ConfigTest
+ *
+ *          Usage:  DS1820_ConfigTest
+ *
+ *          Every check prints one line, the program returns nonzero if any
+ *          check failed.
+ *  @endverbatim
+ *******************************************************************************
+ */
+
+#include <stdio.h>
+#include "OneWire.h"
+#include "DS1820.h"
+
+#define DEVICES     4
+
+/* EEPROM write time in miliseconds */
+#define EEPROM_WRITE_TIME   10
+
+static uint64_t Addresses[DEVICES];
+static int iFailed;
+
+/* Internal functions */
+static void Check(const char *Name, int bPassed);
+static int AlarmsMatch(const int *iHigh, const int *iLow);
+static int Recalled(const int *iHigh, const int *iLow);
+
+int main(void) {
+    int iHigh[DEVICES] = {60, 60, -10, 60};
+    int iLow[DEVICES] = {-5, -5, -55, -5};
+    int i, iReadHigh, iReadLow, iStored;
+
+    OW_SimClear();
+    for (i = 0; i < DEVICES; i++) {
+        Addresses[i] = OW_SimAddress(DS1820_FAMILY_CODE, 0x1820ULL * (i + 1) + 7);
+        OW_SimDeviceAdd(Addresses[i], i & 1);
+    }
+
+    DS1820_TickSet(OW_SimTick);
+    DS1820_DelaySet(OW_SimDelay);
+    DS1820_Init();
+
+    /* Power-on thresholds come from EEPROM */
+    Check("alarm get after power-on",
+            (DS1820_TemperatureAlarmGet(Addresses[0], &iReadHigh, &iReadLow) == DS1820_OK) &&
+            (iReadHigh == 75) && (iReadLow == 70));
+
+    /* Different high and low thresholds, negative ones included */
+    Check("alarm set",
+            DS1820_TemperatureAlarmSet(Addresses[1], 100, -40) == DS1820_OK);
+    Check("alarm get",
+            (DS1820_TemperatureAlarmGet(Addresses[1], &iReadHigh, &iReadLow) == DS1820_OK) &&
+            (iReadHigh == 100) && (iReadLow == -40));
+
+    /* Most common pair is broadcasted, the others are written one by one */
+    Check("alarm set many with verify",
+            DS1820_TemperatureAlarmSetMany(Addresses, iHigh, iLow, DEVICES, 1) == DS1820_OK);
+    Check("alarm set many thresholds", AlarmsMatch(iHigh, iLow));
+
+    /* All devices differ from EEPROM, stored by single transaction */
+    Check("store dirty all",
+            (DS1820_ConfigurationStoreDirty(Addresses, DEVICES, &iStored) == DS1820_OK) &&
+            (iStored == DEVICES));
+    OW_SimDelay(EEPROM_WRITE_TIME);
+    Check("store dirty all thresholds", Recalled(iHigh, iLow));
+
+    /* Nothing changed since the last store */
+    Check("store dirty none",
+            (DS1820_ConfigurationStoreDirty(Addresses, DEVICES, &iStored) == DS1820_OK) &&
+            (iStored == 0));
+
+    /* Only high threshold of one device changed */
+    iHigh[2] = 20;
+    DS1820_TemperatureAlarmSet(Addresses[2], iHigh[2], iLow[2]);
+    Check("store dirty high only",
+            (DS1820_ConfigurationStoreDirty(Addresses, DEVICES, &iStored) == DS1820_OK) &&
+            (iStored == 1));
+    OW_SimDelay(EEPROM_WRITE_TIME);
+    Check("store dirty high only thresholds", Recalled(iHigh, iLow));
+
+    /* Only low thresholds of two devices changed */
+    iLow[0] = 10;
+    iLow[3] = -20;
+    DS1820_TemperatureAlarmSet(Addresses[0], iHigh[0], iLow[0]);
+    DS1820_TemperatureAlarmSet(Addresses[3], iHigh[3], iLow[3]);
+    Check("store dirty low only",
+            (DS1820_ConfigurationStoreDirty(Addresses, DEVICES, &iStored) == DS1820_OK) &&
+            (iStored == 2));
+    OW_SimDelay(EEPROM_WRITE_TIME);
+    Check("store dirty low only thresholds", Recalled(iHigh, iLow));
+
+    printf("%s\n", iFailed ? "FAILED" : "PASSED");
+
+    return iFailed ? 1 : 0;
+}
+
+/**
+ * Prints check result and remembers failure.
+ * @param Name Check description.
+ * @param bPassed Nonzero if check passed.
+ */
+void Check(const char *Name, int bPassed) {
+    printf("%-40s %s\n", Name, bPassed ? "ok" : "FAIL");
+    if (!bPassed) iFailed++;
+}
+
+/**
+ * Compares thresholds of all devices with expected ones.
+ * @param iHigh Expected high thresholds.
+ * @param iLow Expected low thresholds.
+ * @return Nonzero if all devices match.
+ */
+int AlarmsMatch(const int *iHigh, const int *iLow) {
+    int i, iReadHigh, iReadLow;
+
+    for (i = 0; i < DEVICES; i++) {
+        if (DS1820_TemperatureAlarmGet(Addresses[i], &iReadHigh, &iReadLow) != DS1820_OK) return 0;
+        if ((iReadHigh != iHigh[i]) || (iReadLow != iLow[i])) return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Overwrites thresholds of all devices, recalls them from EEPROM and compares
+ * them with expected ones.
+ * @param iHigh Expected high thresholds.
+ * @param iLow Expected low thresholds.
+ * @return Nonzero if all devices match.
+ */
+int Recalled(const int *iHigh, const int *iLow) {
+    if (DS1820_TemperatureAlarmSet(DS1820_ADDRESS_ALL, 0, 0) != DS1820_OK) return 0;
+    if (DS1820_ConfigurationRecall(DS1820_ADDRESS_ALL) != DS1820_OK) return 0;
+
+    return AlarmsMatch(iHigh, iLow);
+}
@@ -0,0 +1,217 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_PackedBench.c
+ * @author  Vojtech Vigner
+ * @brief   Host benchmark of packed address table against plain sorted
+ *          uint64_t table. Reports memory, insertion and lookup time for
+ *          growing tables, so the effect of the smaller entries on cache
+ *          behaviour can be seen once the tables do not fit into caches.
+ *
+ * @verbatim
+ *          Build:  cc -O2 -I.. -I../sim DS1820_PackedBench.c ../DS1820_Packed.c
+ *                  ../sim/OneWire_Sim.c -o DS1820_PackedBench
+ *
+ *          Usage:  DS1820_PackedBench [devices] [lookups] [seed]
+ *
+ *          Tables of 1000, 10000, ... devices up to the given count are
+ *          filled with the same random addresses in random order and
+ *          searched for random present addresses. Both tables are kept
+ *          sorted, inserted by binary search and memmove and searched by
+ *          binary search, they differ only in entry layout. Packed lookup
+ *          includes packing of the searched address and its CRC check.
+ *          Times are in nanoseconds per operation, the same seed gives the
+ *          same addresses. Insertion time grows with table size, a million
+ *          devices take minutes.
+ *  @endverbatim
+ *******************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "OneWire.h"
+#include "DS1820_Packed.h"
+
+static const uint8_t Families[DS1820_PACKED_FAMILY_COUNT] = DS1820_PACKED_FAMILIES;
+
+static uint64_t iState;
+
+/* Internal functions */
+static void Run(int iDevices, long iLookups);
+static uint64_t Random(void);
+static int PlainAdd(uint64_t *Table, int iCount, uint64_t iAddress);
+static int PlainFind(const uint64_t *Table, int iCount, uint64_t iAddress);
+static double Nanoseconds(clock_t iStart, long iOperations);
+
+int main(int argc, char **argv) {
+    int iDevices, iMax = 100000;
+    long iLookups = 1000000;
+    uint64_t iSeed = 1;
+
+    if (argc > 1) iMax = atoi(argv[1]);
+    if (argc > 2) iLookups = atol(argv[2]);
+    if (argc > 3) iSeed = strtoull(argv[3], NULL, 0);
+
+    if ((iMax < 1) || (iLookups < 1) || (iSeed == 0)) {
+        fprintf(stderr, "Usage: %s [devices] [lookups] [seed, nonzero]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%8s %10s %10s %10s %10s %10s %10s\n", "devices", "packed B", "plain B",
+            "pk insert", "pl insert", "pk lookup", "pl lookup");
+
+    for (iDevices = 1000; ; iDevices *= 10) {
+        if (iDevices > iMax) iDevices = iMax;
+        iState = iSeed;
+        Run(iDevices, iLookups);
+        if (iDevices == iMax) break;
+    }
+
+    return 0;
+}
+
+/**
+ * Fills both tables with the same addresses, searches them and prints one
+ * line of results.
+ * @param iDevices Number of devices.
+ * @param iLookups Number of lookups.
+ */
+void Run(int iDevices, long iLookups) {
+    DS1820_PackedAddress *Entries = malloc(iDevices * sizeof (DS1820_PackedAddress));
+    uint64_t *Plain = malloc(iDevices * sizeof (uint64_t));
+    uint64_t *Addresses = malloc(iDevices * sizeof (uint64_t));
+    DS1820_PackedTable Table;
+    double fPackedInsert, fPlainInsert, fPackedLookup, fPlainLookup;
+    clock_t iStart;
+    uint64_t iSeed;
+    long i, iSum = 0;
+    int iCount = 0;
+
+    if ((Entries == 0) || (Plain == 0) || (Addresses == 0)) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    /* Random serials, duplicates are practically impossible in 48 bits */
+    for (i = 0; i < iDevices; i++)
+        Addresses[i] = OW_SimAddress(Families[Random() % DS1820_PACKED_FAMILY_COUNT], Random());
+
+    DS1820_PackedTableInit(&Table, Entries, iDevices);
+
+    iStart = clock();
+    for (i = 0; i < iDevices; i++)
+        if (DS1820_PackedTableAdd(&Table, Addresses[i]) < 0) iSum++;
+    fPackedInsert = Nanoseconds(iStart, iDevices);
+
+    iStart = clock();
+    for (i = 0; i < iDevices; i++)
+        iCount = PlainAdd(Plain, iCount, Addresses[i]);
+    fPlainInsert = Nanoseconds(iStart, iDevices);
+
+    if ((iSum) || (Table.iCount != iCount)) {
+        fprintf(stderr, "Tables differ\n");
+        exit(1);
+    }
+
+    /* Both tables are searched for the same random sequence */
+    iSeed = iState;
+
+    iStart = clock();
+    for (i = 0; i < iLookups; i++)
+        iSum += DS1820_PackedTableFind(&Table, Addresses[Random() % iDevices]);
+    fPackedLookup = Nanoseconds(iStart, iLookups);
+
+    iState = iSeed;
+
+    iStart = clock();
+    for (i = 0; i < iLookups; i++)
+        iSum -= PlainFind(Plain, iCount, Addresses[Random() % iDevices]);
+    fPlainLookup = Nanoseconds(iStart, iLookups);
+
+    /* Sorted orders match, so do indexes of every lookup */
+    if (iSum) {
+        fprintf(stderr, "Lookups differ\n");
+        exit(1);
+    }
+
+    printf("%8d %10lu %10lu %10.1f %10.1f %10.1f %10.1f\n", iDevices,
+            (unsigned long) (iDevices * sizeof (DS1820_PackedAddress)),
+            (unsigned long) (iDevices * sizeof (uint64_t)),
+            fPackedInsert, fPlainInsert, fPackedLookup, fPlainLookup);
+
+    free(Entries);
+    free(Plain);
+    free(Addresses);
+}
+
+/**
+ * Pseudorandom generator, xorshift64*.
+ * @return Next random number.
+ */
+uint64_t Random(void) {
+    iState ^= iState >> 12;
+    iState ^= iState << 25;
+    iState ^= iState >> 27;
+
+    return iState * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Inserts address into sorted plain table, ordered by serial number first
+ * like the packed table, then by family code.
+ * @param Table Plain table with room for one more address.
+ * @param iCount Number of addresses in table.
+ * @param iAddress 64bit device address.
+ * @return New number of addresses.
+ */
+int PlainAdd(uint64_t *Table, int iCount, uint64_t iAddress) {
+    int iLow = 0, iHigh = iCount, iMiddle;
+    uint64_t iKey = (iAddress << 8) | (uint8_t) iAddress;
+
+    while (iLow < iHigh) {
+        iMiddle = (iLow + iHigh) / 2;
+        if (((Table[iMiddle] << 8) | (uint8_t) Table[iMiddle]) < iKey) iLow = iMiddle + 1;
+        else iHigh = iMiddle;
+    }
+
+    if ((iLow < iCount) && (Table[iLow] == iAddress)) return iCount;
+
+    memmove(&Table[iLow + 1], &Table[iLow], (iCount - iLow) * sizeof (uint64_t));
+    Table[iLow] = iAddress;
+
+    return iCount + 1;
+}
+
+/**
+ * Finds address in sorted plain table.
+ * @param Table Plain table.
+ * @param iCount Number of addresses in table.
+ * @param iAddress 64bit device address.
+ * @return Index or -1 if not found.
+ */
+int PlainFind(const uint64_t *Table, int iCount, uint64_t iAddress) {
+    int iLow = 0, iHigh = iCount, iMiddle;
+    uint64_t iKey = (iAddress << 8) | (uint8_t) iAddress, iEntry;
+
+    while (iLow < iHigh) {
+        iMiddle = (iLow + iHigh) / 2;
+        iEntry = (Table[iMiddle] << 8) | (uint8_t) Table[iMiddle];
+
+        if (iEntry == iKey) return iMiddle;
+        if (iEntry < iKey) iLow = iMiddle + 1;
+        else iHigh = iMiddle;
+    }
+
+    return -1;
+}
+
+/**
+ * Returns processor time per operation since start.
+ * @param iStart Start of measurement.
+ * @param iOperations Number of operations.
+ * @return Nanoseconds per operation.
+ */
+double Nanoseconds(clock_t iStart, long iOperations) {
+    return 1e9 * (double) (clock() - iStart) / CLOCKS_PER_SEC / iOperations;
+}
@@ -0,0 +1,137 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_SearchBench.c
+ * @author  Vojtech Vigner
+ * @brief   Host benchmark of ROM search on a large simulated bus. Searches
+ *          the whole bus, checks that every device was found exactly once
+ *          and reports processor time per search and per search time slot.
+ *
+ * @verbatim
+ *          Build:  cc -O2 -I.. -I../sim DS1820_SearchBench.c
+ *                  ../sim/OneWire_Sim.c -o DS1820_SearchBench
+ *
+ *          Usage:  DS1820_SearchBench [devices] [seed]
+ *
+ *          Devices get random 48 bit serial numbers with DS1820 family code,
+ *          half of them are parasite powered. The bus is searched by
+ *          OW_SearchFirst and OW_SearchNext until no device is left, one
+ *          search per device. Search slot is one of the 8 command slots or
+ *          3 slots per address bit of a search. The program returns nonzero
+ *          if a device was missed or found twice. The same seed gives the
+ *          same devices. Default is 10000 devices, search time grows with
+ *          the square of device count, 100000 devices take about a minute.
+ *  @endverbatim
+ *******************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "OneWire.h"
+#include "DS1820.h"
+
+/* Time slots of one search, command and 64 address bit triplets */
+#define SEARCH_SLOTS    (8 + 3 * 64)
+
+static uint64_t iState;
+
+/* Internal functions */
+static uint64_t Random(void);
+static int AddressCompare(const void *A, const void *B);
+
+int main(int argc, char **argv) {
+    long i, iDevices = 10000, iFound = 0, iMissing = 0, iDuplicate = 0;
+    uint64_t *Added, *Found, iAddress;
+    OW_SimStats Stats;
+    double fSeconds;
+    clock_t iStart;
+
+    iState = 1;
+    if (argc > 1) iDevices = atol(argv[1]);
+    if (argc > 2) iState = strtoull(argv[2], NULL, 0);
+
+    if ((iDevices < 1) || (iState == 0)) {
+        fprintf(stderr, "Usage: %s [devices] [seed, nonzero]\n", argv[0]);
+        return 1;
+    }
+
+    Added = malloc(iDevices * sizeof (uint64_t));
+    Found = malloc((iDevices + 1) * sizeof (uint64_t));
+
+    if ((Added == 0) || (Found == 0)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    /* Duplicates are practically impossible in 48 bits, checked anyway */
+    OW_SimClear();
+    for (i = 0; i < iDevices; i++) {
+        Added[i] = OW_SimAddress(DS1820_FAMILY_CODE, Random() & 0xFFFFFFFFFFFFULL);
+        OW_SimDeviceAdd(Added[i], (uint8_t) (i & 1));
+    }
+
+    /* One more slot catches search running past the last device */
+    iStart = clock();
+    iAddress = OW_SearchFirst(0);
+    while ((iAddress) && (iFound <= iDevices)) {
+        Found[iFound++] = iAddress;
+        iAddress = OW_SearchNext();
+    }
+    fSeconds = (double) (clock() - iStart) / CLOCKS_PER_SEC;
+
+    OW_SimStatsGet(&Stats);
+
+    qsort(Added, iDevices, sizeof (uint64_t), AddressCompare);
+    qsort(Found, iFound, sizeof (uint64_t), AddressCompare);
+
+    for (i = 1; i < iDevices; i++)
+        if (Added[i] == Added[i - 1]) {
+            fprintf(stderr, "Seed gives duplicate address, use another one\n");
+            return 1;
+        }
+
+    for (i = 1; i < iFound; i++)
+        if (Found[i] == Found[i - 1]) iDuplicate++;
+
+    /* Both sorted, walk them together */
+    for (i = 0, iAddress = 0; i < iDevices; i++) {
+        while ((iAddress < (uint64_t) iFound) && (Found[iAddress] < Added[i])) iAddress++;
+        if ((iAddress >= (uint64_t) iFound) || (Found[iAddress] != Added[i])) iMissing++;
+    }
+
+    printf("devices          %ld\n", iDevices);
+    printf("found            %ld, %ld missing, %ld duplicate\n", iFound, iMissing, iDuplicate);
+    printf("searches         %u\n", Stats.iSearches);
+    printf("processor time   %.3f s\n", fSeconds);
+    printf("per search       %.1f us\n", 1e6 * fSeconds / Stats.iSearches);
+    printf("per search slot  %.1f ns\n", 1e9 * fSeconds / Stats.iSearches / SEARCH_SLOTS);
+
+    free(Added);
+    free(Found);
+
+    return ((iMissing) || (iDuplicate) || (iFound != iDevices)) ? 1 : 0;
+}
+
+/**
+ * Pseudorandom generator, xorshift64*.
+ * @return Next random number.
+ */
+uint64_t Random(void) {
+    iState ^= iState >> 12;
+    iState ^= iState << 25;
+    iState ^= iState >> 27;
+
+    return iState * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Orders addresses for qsort.
+ * @param A First address.
+ * @param B Second address.
+ * @return Negative, zero or positive as for qsort.
+ */
+int AddressCompare(const void *A, const void *B) {
+    uint64_t iA = *(const uint64_t *) A, iB = *(const uint64_t *) B;
+
+    return (iA > iB) - (iA < iB);
+}
@@ -0,0 +1,179 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_SimBench.c
+ * @author  Vojtech Vigner
+ * @brief   Host benchmark of DS1820 read engine on simulated bus with injected
+ *          faults. Reports effective samples per second of bus time and
+ *          coverage of scratchpad CRC check as fault rates increase.
+ *
+ * @verbatim
+ *          Build:  cc -I.. -I../sim DS1820_SimBench.c ../DS1820.c
+ *                  ../sim/OneWire_Sim.c -o DS1820_SimBench
+ *
+ *          Usage:  DS1820_SimBench [devices] [passes] [seed]
+ *
+ *          Every pass converts all devices, waits conversion time and reads
+ *          all devices by DS1820_TemperatureReadAll. Half of the devices are
+ *          parasite powered. Samples are compared with simulated temperatures,
+ *          wrong sample is a corrupted reading the driver did not detect.
+ *          Coverage is the share of scratchpad reads received with bit error
+ *          which did not result in wrong sample. Rates are in parts per
+ *          million, the same seed gives the same results.
+ *  @endverbatim
+ *******************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "OneWire.h"
+#include "DS1820.h"
+
+/* Fault rates of every scenario in parts per million */
+#define RATE_COUNT      5
+
+static const uint32_t Rates[RATE_COUNT] = {0, 10, 100, 1000, 10000};
+
+static const char *ScenarioNames[] = {
+    "bit error", "no presence", "drop", "short", "brown-out"
+};
+
+static uint64_t Addresses[DS1820_MAX_DEVICES];
+static int Temperatures[DS1820_MAX_DEVICES];
+static int iDevices = DS1820_MAX_DEVICES;
+static long iSamples, iWrong;
+
+/* Internal functions */
+static void SampleCheck(int iDevice, uint32_t iTime, int iTemp);
+static void Run(int iScenario, uint32_t iRate, int iPasses, uint64_t iSeed);
+
+int main(int argc, char **argv) {
+    int iScenario, iRate, iPasses = 100;
+    uint64_t iSeed = 1;
+
+    if (argc > 1) iDevices = atoi(argv[1]);
+    if (argc > 2) iPasses = atoi(argv[2]);
+    if (argc > 3) iSeed = strtoull(argv[3], NULL, 0);
+
+    if ((iDevices < 1) || (iDevices > DS1820_MAX_DEVICES) || (iPasses < 1)) {
+        fprintf(stderr, "Usage: %s [devices 1-%d] [passes] [seed]\n", argv[0], DS1820_MAX_DEVICES);
+        return 1;
+    }
+
+    DS1820_TickSet(OW_SimTick);
+    DS1820_DelaySet(OW_SimDelay);
+    DS1820_SampleSinkAdd(SampleCheck);
+
+    printf("%-12s %6s %7s %8s %10s %6s %8s %8s %9s\n", "scenario", "ppm", "faults",
+            "samples", "samples/s", "wrong", "corrupt", "crc err", "coverage");
+
+    for (iScenario = 0; iScenario < (int) (sizeof (ScenarioNames) / sizeof (ScenarioNames[0])); iScenario++)
+        for (iRate = 0; iRate < RATE_COUNT; iRate++)
+            Run(iScenario, Rates[iRate], iPasses, iSeed);
+
+    return 0;
+}
+
+/**
+ * Read engine consumer, counts samples which differ from simulated
+ * temperature.
+ * @param iDevice Device handle.
+ * @param iTime Sample time.
+ * @param iTemp Temperature in degrees of Celsius * 10.
+ */
+void SampleCheck(int iDevice, uint32_t iTime, int iTemp) {
+    uint64_t iAddress = DS1820_DeviceAddress(iDevice);
+    int i;
+
+    (void) iTime;
+    iSamples++;
+
+    for (i = 0; i < iDevices; i++) {
+        if (Addresses[i] != iAddress) continue;
+        if (iTemp != Temperatures[i]) iWrong++;
+        return;
+    }
+
+    iWrong++;
+}
+
+/**
+ * Runs one fault scenario at one rate on a fresh bus and prints results.
+ * @param iScenario Index into ScenarioNames.
+ * @param iRate Fault rate in parts per million.
+ * @param iPasses Number of conversion and read passes.
+ * @param iSeed Fault generator seed.
+ */
+void Run(int iScenario, uint32_t iRate, int iPasses, uint64_t iSeed) {
+    OW_SimFaults Faults = {0};
+    OW_SimStats Stats;
+    DS1820_Health Health;
+    uint64_t Found[DS1820_MAX_DEVICES];
+    uint64_t iStart;
+    uint32_t iCRCErrors = 0, iFaults;
+    long iUndetected;
+    double fSeconds;
+    int i;
+
+    OW_SimClear();
+    for (i = 0; i < iDevices; i++) {
+        Addresses[i] = OW_SimAddress(DS1820_FAMILY_CODE, 0x1820ULL * (i + 1) + 7);
+        /* Spread over the whole range from -55 C to +125 C */
+        Temperatures[i] = -550 + (i * 1117) % 1801;
+        OW_SimTemperatureSet(OW_SimDeviceAdd(Addresses[i], i & 1), Temperatures[i]);
+    }
+
+    /* Discovery runs on a clean bus */
+    DS1820_DeviceClear();
+    DS1820_Init();
+    if (DS1820_Search(Found, DS1820_MAX_DEVICES) != iDevices) {
+        fprintf(stderr, "Search failed\n");
+        exit(1);
+    }
+    DS1820_PowerMapBuild();
+    DS1820_HealthReset(-1);
+
+    switch (iScenario) {
+        case 0: Faults.iBitError = iRate;
+            break;
+        case 1: Faults.iNoPresence = iRate;
+            break;
+        case 2: Faults.iDrop = iRate;
+            break;
+        case 3: Faults.iShort = iRate;
+            break;
+        default: Faults.iBrownOut = iRate;
+            break;
+    }
+    OW_SimFaultsSet(&Faults, iSeed);
+
+    iSamples = 0;
+    iWrong = 0;
+    iStart = OW_SimTime();
+
+    for (i = 0; i < iPasses; i++) {
+        DS1820_TemperatureConvert(DS1820_ADDRESS_ALL);
+        OW_SimDelay(DS1820_CONVERSION_TIME);
+        DS1820_TemperatureReadAll();
+
+        /* Shorted bus is repaired before the next pass */
+        if (DS1820_BusFault() != DS1820_OK) OW_SimShortClear();
+    }
+
+    OW_SimStatsGet(&Stats);
+    for (i = 0; i < DS1820_DeviceCount(); i++)
+        if (DS1820_HealthGet(i, &Health) == DS1820_OK) iCRCErrors += Health.iCRCErrors;
+
+    fSeconds = (double) (OW_SimTime() - iStart) / 1e6;
+    iFaults = Stats.iBitErrors + Stats.iPresenceLost + Stats.iDrops + Stats.iShorts + Stats.iBrownOuts;
+
+    printf("%-12s %6u %7u %8ld %10.2f %6ld %8u %8u ", ScenarioNames[iScenario], iRate,
+            iFaults, iSamples, iSamples / fSeconds, iWrong, Stats.iCorruptReads, iCRCErrors);
+
+    /* Wrong samples can only come from corrupted reads */
+    if (Stats.iCorruptReads) {
+        iUndetected = (iWrong < (long) Stats.iCorruptReads) ? iWrong : (long) Stats.iCorruptReads;
+        printf("%8.2f%%\n", 100.0 * (double) (Stats.iCorruptReads - iUndetected) / Stats.iCorruptReads);
+    } else {
+        printf("%9s\n", "-");
+    }
+}
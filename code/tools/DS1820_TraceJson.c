@@ -0,0 +1,74 @@
+/**
+ *******************************************************************************
+ * @file    DS1820_TraceJson.c
+ * @author  Vojtech Vigner
+ * @brief   Host tool converting binary DS1820 trace (array of 
+ *          DS1820_TraceEvent records) into Chrome trace / Perfetto JSON.
+ * 
+ * @verbatim
+ *          Usage: DS1820_TraceJson trace.bin [microseconds per tick] > trace.json
+ * 
+ *          Default is 1000 microseconds per tick (DS1820_TickGet), open the
+ *          output in chrome://tracing or ui.perfetto.dev. Thread is the device
+ *          handle + 1, 0 for phases of all devices (search, Skip ROM).
+ *  @endverbatim  
+ *******************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "DS1820_Trace.h"
+
+/* Event record length in the binary file */
+#define RECORD_LENGTH   12
+
+static const char *PhaseNames[] = {
+    "?", "ROM match", "Scratchpad read", "Scratchpad write", "Convert",
+    "Store", "Recall", "Power read", "Search", "Retry"
+};
+
+int main(int argc, char **argv) {
+    FILE *pFile;
+    uint8_t Record[RECORD_LENGTH];
+    uint32_t iTime;
+    int16_t iHandle;
+    uint8_t iPhase;
+    double fScale = 1000.0;
+    int bFirst = 1;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s trace.bin [microseconds per tick]\n", argv[0]);
+        return 1;
+    }
+
+    if (argc > 2) fScale = atof(argv[2]);
+
+    pFile = fopen(argv[1], "rb");
+    if (pFile == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    printf("{\"traceEvents\":[\n");
+
+    while (fread(Record, 1, RECORD_LENGTH, pFile) == RECORD_LENGTH) {
+        iTime = (uint32_t) Record[0] | ((uint32_t) Record[1] << 8) |
+                ((uint32_t) Record[2] << 16) | ((uint32_t) Record[3] << 24);
+        iHandle = (int16_t) (Record[4] | (Record[5] << 8));
+        iPhase = Record[6] & ~DS1820_TRACE_END;
+
+        if (iPhase >= sizeof (PhaseNames) / sizeof (PhaseNames[0])) iPhase = 0;
+
+        printf("%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"result\":%u}}",
+                (bFirst) ? "" : ",\n", PhaseNames[iPhase],
+                (Record[6] & DS1820_TRACE_END) ? "E" : "B",
+                iTime * fScale, iHandle + 1, Record[7]);
+        bFirst = 0;
+    }
+
+    printf("\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    fclose(pFile);
+
+    return 0;
+}